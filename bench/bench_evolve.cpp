@@ -0,0 +1,248 @@
+#define CATCH_CONFIG_MAIN
+
+#include <catch2/catch.hpp>
+#include "evolve.h"
+#include "nqueens.h"
+#include "nqueens_table.h"
+#include "knights_tour.h"
+#include "memoizer.h"
+#include "mapped_cache.h"
+#include <cstdio>
+#include <vector>
+#include <iterator>
+
+/**
+ * Micro and macro benchmarks for the evolve engine, using the benchmarking
+ * support of the vendored catch2. Run all of them with
+ *
+ *     ./evolve_bench
+ *
+ * or a subset by tag, e.g. ./evolve_bench "[knightstour]"
+ *
+ * Note that score() memoizes into a process wide cache, so the score benchmarks
+ * measure a warm cache after the first few samples.
+ */
+
+namespace {
+
+constexpr size_t numInputs = 1024;
+
+template<typename Specimen>
+std::vector<Specimen> randomSpecimens(size_t count) {
+    std::vector<Specimen> specimens;
+    std::generate_n(std::back_inserter(specimens), count, Specimen::random);
+    return specimens;
+}
+
+/// Tours as they look when they are scored during evolution
+std::vector<KnightsTour::Tour> childTours(size_t count) {
+    auto tours = randomSpecimens<KnightsTour::Tour>(count);
+    for(auto& tour : tours) {
+        tour = KnightsTour::mutate(KnightsTour::extend(tour));
+    }
+    return tours;
+}
+
+/// Replay a tour using Tour::moveTargets instead of arithmetic, to keep track of
+/// how the two compare (see Tour::moveTargets)
+unsigned numValidStepsByTable(const KnightsTour::Tour& tour) {
+    KnightsTour::Tour::Board board;
+    std::uint8_t sq = KnightsTour::Tour::startSq;
+    for(const auto& mov : tour.tour_) {
+        std::uint8_t target = KnightsTour::Tour::moveTargets[sq][KnightsTour::movIndex(mov)];
+        if(!board.maybeApplyTarget(target)) {
+            break;
+        }
+        sq = target;
+    }
+    return board.numMoves();
+}
+
+template<typename Specimen, typename Config = Evolve::DefaultConfig>
+void benchmarkCircleOfLife(size_t populationSize, const std::string& configName = "") {
+    Evolve::Generation<Specimen, Config> generation{randomSpecimens<Specimen>(populationSize)};
+    BENCHMARK("circleOfLife" + configName + ", population " + std::to_string(populationSize)) {
+        generation.circleOfLife();
+        return generation.hasSolutions();
+    };
+}
+
+struct TournamentConfig : Evolve::DefaultConfig {
+    using Selection = Evolve::TournamentSelection<3>;
+};
+
+struct ElitistConfig : Evolve::DefaultConfig {
+    using Replacement = Evolve::ElitistReplacement<2>;
+};
+
+struct TwoPointConfig : Evolve::DefaultConfig {
+    using Mating = Evolve::CrossAndMutate<2>;
+};
+
+struct FusedConfig : Evolve::DefaultConfig {
+    static constexpr bool fuseScoring = true;
+};
+
+struct CollapseConfig : Evolve::DefaultConfig {
+    static constexpr bool collapseDuplicates = true;
+};
+
+}
+
+TEST_CASE("nqueens micro", "[nqueens][micro]") {
+    auto boards = randomSpecimens<NQueens::Board>(numInputs);
+    size_t idx{0};
+    auto next = [&]() -> const NQueens::Board& { return boards[idx++ % numInputs]; };
+
+    BENCHMARK("numAttackingPairs") {
+        return next().numAttackingPairs();
+    };
+    BENCHMARK("score") {
+        return NQueens::score(next());
+    };
+    BENCHMARK("cross") {
+        return NQueens::cross(next(), next(), 4);
+    };
+    BENCHMARK("mutate") {
+        return NQueens::mutate(next());
+    };
+    BENCHMARK("mate") {
+        return NQueens::mate(next(), next());
+    };
+
+    auto table = NQueens::FitnessTable::generate();
+    table.use();
+    BENCHMARK("score, fitness table") {
+        return NQueens::score(next());
+    };
+}
+
+TEST_CASE("nqueens fitness table", "[nqueens][startup]") {
+    const std::string path{"evolve_bench.table"};
+    BENCHMARK("generate, 1 thread") {
+        return NQueens::FitnessTable::generate(1).data();
+    };
+    BENCHMARK("generate") {
+        return NQueens::FitnessTable::generate().data();
+    };
+    NQueens::FitnessTable::generate().save(path);
+    BENCHMARK("load") {
+        return NQueens::FitnessTable::load(path)->data();
+    };
+    std::remove(path.c_str());
+}
+
+TEST_CASE("knightstour micro", "[knightstour][micro]") {
+    auto tours = childTours(numInputs);
+    size_t idx{0};
+    auto next = [&]() -> const KnightsTour::Tour& { return tours[idx++ % numInputs]; };
+
+    BENCHMARK("numValidSteps") {
+        return next().numValidSteps();
+    };
+    BENCHMARK("numValidSteps using moveTargets") {
+        return numValidStepsByTable(next());
+    };
+    BENCHMARK("score") {
+        return KnightsTour::score(next());
+    };
+    BENCHMARK("fingerprint, hashing the moves") {
+        const auto& tour = next();
+        return Memoizer::fingerprintBytes(tour.tour_.data(), sizeof(tour.tour_));
+    };
+    BENCHMARK("fingerprint") {
+        return KnightsTour::fingerprint(next());
+    };
+    BENCHMARK("cross") {
+        return KnightsTour::cross(next(), next(), KnightsTour::Tour::length/2);
+    };
+    BENCHMARK("mutate") {
+        return KnightsTour::mutate(next());
+    };
+    BENCHMARK("extend") {
+        return KnightsTour::extend(next());
+    };
+    BENCHMARK("mate") {
+        return KnightsTour::mate(next(), next());
+    };
+}
+
+TEST_CASE("memoizer micro", "[memoizer][micro]") {
+    auto add = [](int a, int b) {
+        return a + b;
+    };
+    using CacheT = Memoizer::Cache<decltype(add), int, int>;
+    Memoizer::Memoizer<CacheT, decltype(add)> memoizer{add};
+    for(int i = 0; i < static_cast<int>(numInputs); i++) {
+        memoizer(i, i);
+    }
+
+    int idx{0};
+    BENCHMARK("lookup, " + std::to_string(numInputs) + " entries") {
+        idx = (idx + 1) % numInputs;
+        return memoizer(idx, idx);
+    };
+}
+
+TEST_CASE("nqueens macro", "[nqueens][macro]") {
+    benchmarkCircleOfLife<NQueens::Board>(50);
+    benchmarkCircleOfLife<NQueens::Board>(1000);
+}
+
+TEST_CASE("knightstour macro", "[knightstour][macro]") {
+    benchmarkCircleOfLife<KnightsTour::Tour>(50);
+    benchmarkCircleOfLife<KnightsTour::Tour>(1000);
+}
+
+TEST_CASE("config macro", "[nqueens][knightstour][macro][config]") {
+    benchmarkCircleOfLife<NQueens::Board>(1000, " default");
+    benchmarkCircleOfLife<NQueens::Board, TournamentConfig>(1000, " tournament");
+    benchmarkCircleOfLife<NQueens::Board, ElitistConfig>(1000, " elitist");
+    benchmarkCircleOfLife<NQueens::Board, TwoPointConfig>(1000, " two point crossover");
+    benchmarkCircleOfLife<NQueens::Board, FusedConfig>(1000, " fused scoring");
+    benchmarkCircleOfLife<NQueens::Board, CollapseConfig>(1000, " collapsed duplicates");
+    benchmarkCircleOfLife<KnightsTour::Tour>(1000, " default");
+    benchmarkCircleOfLife<KnightsTour::Tour, FusedConfig>(1000, " fused scoring");
+    benchmarkCircleOfLife<KnightsTour::Tour, CollapseConfig>(1000, " collapsed duplicates");
+}
+
+TEST_CASE("persistent score cache", "[knightstour][memoizer][startup]") {
+    auto tours = childTours(numInputs);
+    auto realScore = [](const KnightsTour::Tour& tour) {
+        return tour.numValidSteps();
+    };
+    using MappedCacheT = Memoizer::MappedCache<decltype(realScore), KnightsTour::Tour, KnightsTour::TourFingerprint>;
+    using MapCacheT = Memoizer::Cache<decltype(realScore), KnightsTour::Tour>;
+    const std::string path{"evolve_bench.cache"};
+    constexpr size_t capacity = 1 << 16;
+
+    /// Startup followed by scoring every tour once, as at the start of a run
+    auto scoreAll = [&](auto& memoizer) {
+        unsigned sum{0};
+        for(const auto& tour : tours) {
+            sum += memoizer(tour);
+        }
+        return sum;
+    };
+
+    BENCHMARK("std::map, " + std::to_string(numInputs) + " tours") {
+        Memoizer::Memoizer<MapCacheT, decltype(realScore)> memoizer{realScore};
+        return scoreAll(memoizer);
+    };
+    BENCHMARK_ADVANCED("mapped cold, " + std::to_string(numInputs) + " tours")(Catch::Benchmark::Chronometer meter) {
+        meter.measure([&]() {
+            std::remove(path.c_str());
+            Memoizer::Memoizer<MappedCacheT, decltype(realScore)> memoizer{realScore, MappedCacheT{path, capacity}};
+            return scoreAll(memoizer);
+        });
+    };
+    {
+        Memoizer::Memoizer<MappedCacheT, decltype(realScore)> memoizer{realScore, MappedCacheT{path, capacity}};
+        scoreAll(memoizer);
+    }
+    BENCHMARK("mapped warm, " + std::to_string(numInputs) + " tours") {
+        Memoizer::Memoizer<MappedCacheT, decltype(realScore)> memoizer{realScore, MappedCacheT{path, capacity}};
+        return scoreAll(memoizer);
+    };
+    std::remove(path.c_str());
+}
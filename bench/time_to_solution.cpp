@@ -0,0 +1,273 @@
+#include "evolve.h"
+#include "nqueens.h"
+#include "knights_tour.h"
+#include <cassert>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <limits>
+#include <optional>
+#include <sstream>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+/**
+ * Time to solution harness.
+ *
+ * Evolution is stochastic, so the time it takes to find a solution varies a lot
+ * from run to run. This runs Evolve::evolve() for many seeds per configuration,
+ * records the generations and wall time to the first solution and reports the
+ * median, p90, p99 and mean along with 95% confidence intervals. Runs that reach
+ * --max-generations without a solution are censored: they rank above every solved
+ * run, so a statistic that lands on one of them is only known to be beyond
+ * --max-generations and is shown as >max-generations (null in the JSON). The mean
+ * is only known when every run solves.
+ *
+ *     evolve_tts [--runs N] [--seed S] [--max-generations G]
+ *                [--csv runs.csv] [--json summary.json] [config...]
+ *
+ * A config is problem:population[:repairDepth:repairBudget], e.g. nqueens:50 or
+ * knightstour:50:8:1000. The CSV has one line per run and the JSON has the
+ * summary of each config.
+ *
+ * Note that score() memoizes into a process wide cache which stays warm from one
+ * run to the next.
+ */
+
+namespace {
+
+struct Config {
+    std::string problem_;
+    size_t population_{50};
+    KnightsTour::RepairOptions repair_;
+
+    std::string name() const {
+        std::ostringstream os;
+        os << problem_ << ':' << population_;
+        if(repair_.enabled()) {
+            os << ':' << repair_.maxDepth_ << ':' << repair_.nodeBudget_;
+        }
+        return os.str();
+    }
+};
+
+struct Run {
+    unsigned seed_;
+    bool solved_;
+    unsigned generations_;
+    double wallMs_;
+};
+
+/// The value of a run that did not solve, which ranks above every solved run
+constexpr double unsolved = std::numeric_limits<double>::infinity();
+
+/// Order statistics of a sample along with 95% confidence intervals for the
+/// mean (normal approximation) and the median (distribution free, from the
+/// binomial distribution of ranks). Statistics that depend on unsolved runs
+/// are unsolved
+struct Summary {
+    double median_, p90_, p99_, mean_;
+    double meanLow_, meanHigh_, medianLow_, medianHigh_;
+};
+
+/// Summarize the values of every run, solved or not
+Summary summarize(std::vector<double> values) {
+    assert(!values.empty());
+    std::sort(std::begin(values), std::end(values));
+    const double n = values.size();
+    auto rank = [&](double r) {
+        return values[std::min<size_t>(values.size() - 1, std::max(1.0, std::ceil(r)) - 1)];
+    };
+
+    Summary summary;
+    summary.median_ = rank(0.5*n);
+    summary.p90_ = rank(0.9*n);
+    summary.p99_ = rank(0.99*n);
+
+    if(values.back() == unsolved) {
+        summary.mean_ = summary.meanLow_ = summary.meanHigh_ = unsolved;
+    } else {
+        summary.mean_ = std::accumulate(std::begin(values), std::end(values), 0.0)/n;
+        double sqDiffs = std::accumulate(std::begin(values), std::end(values), 0.0,
+                                         [&](double sum, double v) { return sum + (v - summary.mean_)*(v - summary.mean_); });
+        double halfWidth = n > 1 ? 1.96*std::sqrt(sqDiffs/(n - 1))/std::sqrt(n) : 0;
+        summary.meanLow_ = summary.mean_ - halfWidth;
+        summary.meanHigh_ = summary.mean_ + halfWidth;
+    }
+
+    summary.medianLow_ = rank(std::floor(0.5*n - 0.98*std::sqrt(n)));
+    summary.medianHigh_ = rank(std::ceil(1 + 0.5*n + 0.98*std::sqrt(n)));
+    return summary;
+}
+
+/// Tours are mated by a policy that holds the repair options
+struct KnightsTourConfig : Evolve::DefaultConfig {
+    using Mating = KnightsTour::MateWithRepair;
+};
+
+template<typename Specimen, typename GenerationConfig = Evolve::DefaultConfig>
+Run runOnce(const Config& config, unsigned seed, unsigned maxGenerations) {
+    randomEngine().seed(seed);
+
+    std::vector<Specimen> specimens;
+    std::generate_n(std::back_inserter(specimens), config.population_, Specimen::random);
+    Evolve::Generation<Specimen, GenerationConfig> generation{std::move(specimens)};
+    if constexpr (std::is_same_v<typename GenerationConfig::Mating, KnightsTour::MateWithRepair>) {
+        generation.mating().options_ = config.repair_;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    unsigned generations = Evolve::evolve(generation, maxGenerations, [](const auto&) {});
+    auto end = std::chrono::steady_clock::now();
+
+    return {seed, generation.hasSolutions(), generations,
+            std::chrono::duration<double, std::milli>(end - start).count()};
+}
+
+std::optional<Config> parseConfig(const std::string& str) {
+    std::vector<std::string> fields;
+    std::istringstream is{str};
+    for(std::string field; std::getline(is, field, ':');) {
+        fields.push_back(field);
+    }
+    if(fields.empty() || (fields[0] != "nqueens" && fields[0] != "knightstour")
+            || fields.size() == 3 || fields.size() > 4) {
+        return std::nullopt;
+    }
+    Config config;
+    config.problem_ = fields[0];
+    if(fields.size() > 1) {
+        config.population_ = std::stoul(fields[1]);
+    }
+    if(fields.size() == 4) {
+        config.repair_ = {static_cast<unsigned>(std::stoul(fields[2])),
+                          static_cast<unsigned>(std::stoul(fields[3]))};
+    }
+    return config;
+}
+
+/// Prints a statistic, or how it is bounded if it is unsolved
+struct Printed {
+    double value_;
+};
+
+std::ostream& operator<<(std::ostream& os, Printed printed) {
+    if(printed.value_ == unsolved) {
+        return os << ">max-generations";
+    }
+    return os << printed.value_;
+}
+
+/// Writes a statistic as JSON, null if it is unsolved
+struct Json {
+    double value_;
+};
+
+std::ostream& operator<<(std::ostream& os, Json json) {
+    if(json.value_ == unsolved) {
+        return os << "null";
+    }
+    return os << json.value_;
+}
+
+void writeSummary(std::ostream& os, const char* name, const Summary& s) {
+    os << "\"" << name << "\": {\"median\": " << Json{s.median_} << ", \"p90\": " << Json{s.p90_}
+       << ", \"p99\": " << Json{s.p99_} << ", \"mean\": " << Json{s.mean_}
+       << ", \"mean_ci95\": [" << Json{s.meanLow_} << ", " << Json{s.meanHigh_} << "]"
+       << ", \"median_ci95\": [" << Json{s.medianLow_} << ", " << Json{s.medianHigh_} << "]}";
+}
+
+}
+
+int main(int argc, char** argv) {
+    unsigned numRuns{20}, baseSeed{1}, maxGenerations{1000000};
+    std::string csvPath, jsonPath;
+    std::vector<Config> configs;
+
+    for(int i = 1; i < argc; i++) {
+        std::string arg{argv[i]};
+        bool hasValue = i + 1 < argc;
+        if(arg == "--runs" && hasValue) {
+            numRuns = std::stoul(argv[++i]);
+        } else if(arg == "--seed" && hasValue) {
+            baseSeed = std::stoul(argv[++i]);
+        } else if(arg == "--max-generations" && hasValue) {
+            maxGenerations = std::stoul(argv[++i]);
+        } else if(arg == "--csv" && hasValue) {
+            csvPath = argv[++i];
+        } else if(arg == "--json" && hasValue) {
+            jsonPath = argv[++i];
+        } else if(auto config = parseConfig(arg)) {
+            configs.push_back(*config);
+        } else {
+            numRuns = 0;
+        }
+        if(!numRuns) {
+            std::cerr << "Usage: \n evolve_tts [--runs N] [--seed S] [--max-generations G] "
+                         "[--csv path] [--json path] [problem:population[:repairDepth:repairBudget]...]\n";
+            return 1;
+        }
+    }
+    if(configs.empty()) {
+        configs = {*parseConfig("nqueens:50"), *parseConfig("knightstour:50"),
+                   *parseConfig("knightstour:50:8:1000")};
+    }
+
+    std::ofstream csv, json;
+    if(!csvPath.empty()) {
+        csv.open(csvPath);
+        csv << "config,seed,solved,generations,wall_ms\n";
+    }
+    if(!jsonPath.empty()) {
+        json.open(jsonPath);
+        json << "[\n";
+    }
+
+    for(size_t c = 0; c < configs.size(); c++) {
+        const auto& config = configs[c];
+        std::vector<double> generations, wallMs;
+        unsigned numSolved{0};
+        for(unsigned run = 0; run < numRuns; run++) {
+            auto result = config.problem_ == "nqueens"
+                    ? runOnce<NQueens::Board>(config, baseSeed + run, maxGenerations)
+                    : runOnce<KnightsTour::Tour, KnightsTourConfig>(config, baseSeed + run, maxGenerations);
+            generations.push_back(result.solved_ ? result.generations_ : unsolved);
+            wallMs.push_back(result.solved_ ? result.wallMs_ : unsolved);
+            numSolved += result.solved_;
+            if(csv.is_open()) {
+                csv << config.name() << ',' << result.seed_ << ',' << result.solved_ << ','
+                    << result.generations_ << ',' << result.wallMs_ << '\n';
+            }
+        }
+
+        auto genSummary = summarize(generations);
+        auto wallSummary = summarize(wallMs);
+        std::cout << config.name() << " : " << numSolved << "/" << numRuns << " solved"
+                  << ", generations median " << Printed{genSummary.median_}
+                  << " [" << Printed{genSummary.medianLow_} << ", " << Printed{genSummary.medianHigh_} << "]"
+                  << " p90 " << Printed{genSummary.p90_} << " p99 " << Printed{genSummary.p99_}
+                  << ", wall ms median " << Printed{wallSummary.median_}
+                  << " [" << Printed{wallSummary.medianLow_} << ", " << Printed{wallSummary.medianHigh_} << "]"
+                  << " p90 " << Printed{wallSummary.p90_} << " p99 " << Printed{wallSummary.p99_};
+        if(numSolved < numRuns) {
+            std::cout << ", " << numRuns - numSolved << " unsolved after " << maxGenerations << " generations";
+        }
+        std::cout << std::endl;
+
+        if(json.is_open()) {
+            json << "  {\"config\": \"" << config.name() << "\", \"runs\": " << numRuns
+                 << ", \"solved\": " << numSolved << ", ";
+            writeSummary(json, "generations", genSummary);
+            json << ", ";
+            writeSummary(json, "wall_ms", wallSummary);
+            json << "}" << (c + 1 < configs.size() ? "," : "") << "\n";
+        }
+    }
+
+    if(json.is_open()) {
+        json << "]\n";
+    }
+}
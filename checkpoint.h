@@ -0,0 +1,231 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <mutex>
+#include <random>
+#include <span>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+extern std::default_random_engine& randomEngine();
+
+/**
+ * \ingroup Evolve
+ *
+ * Checkpointing of Evolve::Generation, so that long runs can be resumed after a
+ * restart. A checkpoint holds the population, its fitness scores if they are
+ * known, the generation counter and the state of both the generation's engine
+ * and randomEngine(), so a resumed run evolves exactly like the original one
+ * would have. Only trivially copyable specimens can be checkpointed, and they
+ * are written in bulk as raw bytes.
+ *
+ * Pass a Checkpointer along with the sink to Evolve::evolve()
+ *
+ *     Evolve::Checkpointer checkpointer{generation, "tour.ckpt", 1000};
+ *     Evolve::evolve(generation, 0, [&](const auto& stats) { checkpointer(stats); });
+ *
+ * and resume with Evolve::restore(generation, "tour.ckpt").
+ */
+
+namespace Evolve {
+
+namespace detail {
+
+/// A checkpoint is this header followed by the text serializations of the two
+/// engines, the specimens and then the fitness scores if scored_ is set. It is
+/// in native byte order, so it is only meant to be read where it was written
+struct CheckpointHeader {
+    static constexpr char expectedMagic[4] = {'E','V','C','K'};
+    static constexpr std::uint32_t currentVersion = 1;
+
+    char magic_[4] = {'E','V','C','K'};
+    std::uint32_t version_{currentVersion};
+    std::uint32_t specimenSize_{0};
+    std::uint32_t scored_{0};
+    std::uint64_t generation_{0};
+    std::uint64_t populationSize_{0};
+    std::uint32_t engineStateSize_{0};
+    std::uint32_t randomStateSize_{0};
+};
+
+inline
+std::string engineState(const std::default_random_engine& engine) {
+    std::ostringstream os;
+    os << engine;
+    return os.str();
+}
+
+inline
+bool setEngineState(std::default_random_engine& engine, const std::string& state) {
+    std::istringstream is{state};
+    is >> engine;
+    return !is.fail();
+}
+
+inline
+void append(std::vector<char>& buffer, const void* data, size_t size) {
+    auto bytes = static_cast<const char*>(data);
+    buffer.insert(std::end(buffer), bytes, bytes + size);
+}
+
+/// Reads a checkpoint front to back, failing instead of reading past its end
+class CheckpointReader {
+    std::span<const char> data_;
+
+public:
+    explicit CheckpointReader(std::span<const char> data) : data_{data}
+    {}
+
+    bool read(void* out, size_t size) {
+        if(size > data_.size()) {
+            return false;
+        }
+        std::memcpy(out, data_.data(), size);
+        data_ = data_.subspan(size);
+        return true;
+    }
+
+    bool read(std::string& out, size_t size) {
+        if(size > data_.size()) {
+            return false;
+        }
+        out.resize(size);
+        return read(out.data(), size);
+    }
+
+    size_t remaining() const {
+        return data_.size();
+    }
+};
+
+}
+
+/// Takes a checkpoint of generation every interval generations when called with
+/// the stats of each generation, e.g. from the sink passed to evolve(). The
+/// generation is copied into a buffer on the calling thread, which is a memcpy
+/// of the population, and written out on a background thread. The file is
+/// written next to path and renamed over it, so a crash while writing leaves
+/// the previous checkpoint intact
+template<typename GenerationT>
+class Checkpointer {
+    const GenerationT& generation_;
+    std::string path_;
+    unsigned interval_;
+
+    /// Filled on the evolving thread and swapped with pending_, so that both
+    /// buffers are reused
+    std::vector<char> snapshot_;
+
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::vector<char> pending_;
+    bool hasPending_{false};
+    bool writing_{false};
+    bool stopping_{false};
+
+    /// Number of checkpoints that could not be written
+    unsigned numFailed_{0};
+
+    std::thread thread_;
+
+    void run() {
+        std::vector<char> bytes;
+        std::unique_lock<std::mutex> lock{mutex_};
+        while(true) {
+            cv_.wait(lock, [this]() { return stopping_ || hasPending_; });
+            if(!hasPending_) {
+                return;
+            }
+            std::swap(bytes, pending_);
+            hasPending_ = false;
+            writing_ = true;
+            lock.unlock();
+            bool written = write(bytes);
+            lock.lock();
+            writing_ = false;
+            numFailed_ += !written;
+            cv_.notify_all();
+        }
+    }
+
+    bool write(const std::vector<char>& bytes) const {
+        std::string tmpPath{path_ + ".tmp"};
+        std::ofstream os{tmpPath, std::ios::binary | std::ios::trunc};
+        os.write(bytes.data(), bytes.size());
+        os.close();
+        if(!os || std::rename(tmpPath.c_str(), path_.c_str()) != 0) {
+            std::remove(tmpPath.c_str());
+            return false;
+        }
+        return true;
+    }
+
+public:
+    Checkpointer(const GenerationT& generation, std::string path, unsigned interval) :
+        generation_{generation},
+        path_{std::move(path)},
+        interval_{interval},
+        thread_{[this]() { run(); }}
+    {}
+
+    ~Checkpointer() {
+        {
+            std::lock_guard<std::mutex> lock{mutex_};
+            stopping_ = true;
+        }
+        cv_.notify_all();
+        thread_.join();
+    }
+
+    Checkpointer(const Checkpointer&) = delete;
+    Checkpointer& operator=(const Checkpointer&) = delete;
+
+    template<typename Stats>
+    void operator()(const Stats& stats) {
+        if(interval_ && stats.generation_ % interval_ == 0) {
+            save();
+        }
+    }
+
+    /// Number of checkpoints that could not be written out so far, e.g.
+    /// because the disk is full. The previous checkpoint is kept then
+    unsigned numFailed() {
+        std::lock_guard<std::mutex> lock{mutex_};
+        return numFailed_;
+    }
+
+    /// Wait for the checkpoints taken so far to be written out
+    void wait() {
+        std::unique_lock<std::mutex> lock{mutex_};
+        cv_.wait(lock, [this]() { return !hasPending_ && !writing_; });
+    }
+
+    /// Checkpoint now. A checkpoint not yet written is replaced by this one
+    void save() {
+        generation_.checkpoint(snapshot_);
+        {
+            std::lock_guard<std::mutex> lock{mutex_};
+            std::swap(pending_, snapshot_);
+            hasPending_ = true;
+        }
+        cv_.notify_all();
+    }
+};
+
+/// Resume generation from the checkpoint at path. Returns false, leaving
+/// generation as it was, if there is no valid checkpoint for it there
+template<typename GenerationT>
+bool restore(GenerationT& generation, const std::string& path) {
+    std::ifstream is{path, std::ios::binary};
+    std::vector<char> bytes{std::istreambuf_iterator<char>{is}, std::istreambuf_iterator<char>{}};
+    return generation.restore(bytes);
+}
+
+}
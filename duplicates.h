@@ -0,0 +1,80 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+/**
+ * \ingroup Evolve
+ *
+ * Finding the duplicate specimens of a generation, so that Evolve::Generation
+ * can score each distinct genome once (see DefaultConfig::collapseDuplicates).
+ * Specimens are told apart by their fingerprints (see SpecimenFingerprint), so
+ * two specimens whose 64 bit fingerprints collide are taken to be duplicates.
+ */
+
+namespace Evolve {
+
+namespace detail {
+
+/// Maps every specimen of a population to the first specimen with the same
+/// fingerprint, through an open addressed table of fingerprints. The table and
+/// the mapping are reused from one population to the next, so finding
+/// duplicates does not allocate once warmed up
+class DuplicateFinder {
+    static constexpr std::size_t empty = std::numeric_limits<std::size_t>::max();
+
+    struct Slot {
+        std::uint64_t fingerprint_;
+        std::size_t idx_;
+    };
+
+    std::vector<Slot> slots_;
+    std::vector<std::size_t> original_;
+
+public:
+    /// Find the duplicates among count specimens and return how many there
+    /// are, not counting the first of each group of identical specimens
+    template<typename Specimen, typename Fingerprint>
+    std::size_t find(const Specimen* specimens, std::size_t count, const Fingerprint& fingerprint) {
+        //Keep the table atmost half full
+        std::size_t numSlots{1};
+        while(numSlots < 2*count) {
+            numSlots <<= 1;
+        }
+        slots_.resize(numSlots);
+        std::fill(std::begin(slots_), std::end(slots_), Slot{0, empty});
+        original_.resize(count);
+
+        std::size_t numDuplicates{0};
+        for(std::size_t idx = 0; idx < count; idx++) {
+            auto hash = fingerprint(specimens[idx]);
+            for(std::size_t probe = hash & (numSlots - 1); ; probe = (probe + 1) & (numSlots - 1)) {
+                Slot& slot = slots_[probe];
+                if(slot.idx_ == empty) {
+                    slot = {hash, idx};
+                    original_[idx] = idx;
+                    break;
+                }
+                if(slot.fingerprint_ == hash) {
+                    original_[idx] = slot.idx_;
+                    ++numDuplicates;
+                    break;
+                }
+            }
+        }
+        return numDuplicates;
+    }
+
+    /// The index of the first specimen identical to the one at idx, which is
+    /// idx itself unless it is a duplicate
+    std::size_t original(std::size_t idx) const {
+        return original_[idx];
+    }
+};
+
+}
+
+}
@@ -8,6 +8,23 @@
 #include <array>
 #include <tuple>
 #include <cassert>
+#include <functional>
+#include <type_traits>
+#include <utility>
+#include <chrono>
+#include <optional>
+#include <atomic>
+#include <cstring>
+#include <new>
+#include <span>
+#include "instrument.h"
+#include "stats.h"
+#include "memoizer.h"
+#include "specimen.h"
+#include "population.h"
+#include "policies.h"
+#include "checkpoint.h"
+#include "duplicates.h"
 
 /**
  * \defgroup Evolve A simple class to solve problems using evolution
@@ -27,138 +44,445 @@ namespace Evolve {
  *
  * This class takes in a Specimen type as a template parameter. The semantics
  * of the fitness functions, mating etc are delegated to the specimen class. Each
- * specimen class needs to define these functions. The operations on the specimen
- * type are found via ADL lookup so the Specimen types should ideally be in their
- * own namespaces
+ * specimen class needs to define these functions (see EvolvableSpecimen in
+ * specimen.h). The operations on the specimen type are found via ADL lookup so
+ * the Specimen types should ideally be in their own namespaces
+ *
+ * How parents are selected and mated, which specimens survive and what
+ * happens to solutions is decided at compile time by a Config (see policies.h).
  *
  * We solve two classic chess problems using this approach - knight's tour and NQueens
  * knights_tour.h and nqueens.h provide the specimen class for these two problems
  * respectively
  *
- * TODO - Use concepts to specify the requirements of the Specimen type(s)
  * TODO - Use continuous evolution where there are not discrete _generation_ units.
  *
  */
 
-template<typename Specimen>
+template<typename Specimen, typename Config = DefaultConfig>
 class Generation {
 
 private:
 
     /// These are the specimens of the current generation. They
     /// will mate as per their fitness functions and create offsprings
-    /// The offsprings will constitute the next generation
-    std::vector<Specimen> specimens_;
-
-    /// Each Specimen type defines a scoring function to determine
-    /// how fit a specimen is
-    std::vector<unsigned> fitnessScores_;
+    /// The offsprings will constitute the next generation. Each Specimen
+    /// type defines a scoring function to determine how fit a specimen is,
+    /// and the scores are kept alongside the specimens
+    Population<Specimen> specimens_;
 
     /// Parents will be chosen as per the specimen's fitness. More fit
     /// specimen will have a higher liklihood of being chosen.
     std::vector<std::tuple<size_t,size_t>> parents_;
 
+    typename Config::Selection selection_;
+    typename Config::Mating mating_;
+    typename Config::Replacement replacement_;
+    typename Config::SolutionHandling solutionHandling_;
+    std::default_random_engine engine_;
+
     /// Two parents will be combined to form two children. The combination
     /// happens by selecting a random crossover point and then creating hybrid
     /// specimen by combing parts of the parents from different sides of the
     /// crossover point. Each child is further mutated at a random point.
-    std::vector<Specimen> children_;
+    Population<Specimen> children_;
+
+    /// Number of pairs of parents mated by the last makeOffSprings()
+    size_t numMated_{0};
+
+    /// Receives the child that does not fit in the population
+    std::optional<Specimen> spare_;
+
+    /// Children are scored as they are mated when the config fuses scoring,
+    /// and when looking for solutions among them scores them anyway (see
+    /// DeclaredMaxFitnessSpecimen), so that no child is scored twice
+    static constexpr bool scoreOffSprings = Config::fuseScoring || DeclaredMaxFitnessSpecimen<Specimen>;
+
+    /// Set when the specimens were already scored as they were created (see
+    /// scoreOffSprings), along with the score cache stats from before they
+    /// were scored
+    bool scored_{false};
+    Memoizer::Stats scoredCacheStats_;
+
+    /// Finds the specimens that need not be scored, when duplicates are
+    /// collapsed (see DefaultConfig::collapseDuplicates)
+    detail::DuplicateFinder duplicates_;
 
     /// After a generation has produced children, we see if there are any solutions
     /// and add them here.
     std::vector<Specimen> solutions_;
 
+    /// Called with every solution as soon as it is found. Evolution waits for
+    /// it to return, so slow work such as I/O should be handed off (see
+    /// SolutionReporter)
+    std::function<void(const Specimen&)> onSolution_;
+
+    /// Evolution stops as soon as the flag is set, even in the middle of a
+    /// generation. The flag is our own unless it is shared with other
+    /// generations (see shareCancellation())
+    std::atomic<bool> ownCancelFlag_{false};
+    std::atomic<bool>* cancelFlag_{&ownCancelFlag_};
+
+    /// Statistics of the last generation, computed as it is scored
+    GenerationStats stats_;
+
+    std::chrono::steady_clock::time_point created_{std::chrono::steady_clock::now()};
+
 public:
     template<typename Iterator>
     Generation(Iterator begin, Iterator end) :
         specimens_{begin,end}
     {
         assert(specimens_.size() >=2 );
-        fitnessScores_.reserve(specimens_.size());
+        specimens_.reserve(specimens_.size());
+        children_.reserve(specimens_.size());
+        parents_.reserve(specimens_.size()/2 + 1);
     }
 
     template<typename SpecimenCont>
-    Generation(SpecimenCont&& cont) : specimens_{std::move(cont)}
+    Generation(SpecimenCont&& cont) :
+        Generation(std::make_move_iterator(std::begin(cont)), std::make_move_iterator(std::end(cont)))
     {
-        assert(specimens_.size() >=2 );
-        fitnessScores_.reserve(specimens_.size());
+        static_assert(!std::is_lvalue_reference_v<SpecimenCont>, "Pass the specimens as an rvalue or as iterators");
     }
 
+    /// The children become the specimens. Swapping the buffers instead of
+    /// copying the children means no specimen is copied, and the old specimens
+    /// are kept as the slots that the next generation's children overwrite
     void promote() {
-        specimens_ = children_;
-        fitnessScores_.clear();
+        PhaseTimer timer{stats_.phases_, Phase::promote};
+        specimens_.swap(children_);
         parents_.clear();
-        children_.clear();
+        //A cancelled generation was not completely scored
+        scored_ = scoreOffSprings && !cancelled();
+    }
+
+    /// The mating policy, for policies with settings of their own (e.g.
+    /// KnightsTour::MateWithRepair)
+    typename Config::Mating& mating() {
+        return mating_;
+    }
+
+    void setSolutionCallback(std::function<void(const Specimen&)> onSolution) {
+        onSolution_ = std::move(onSolution);
+    }
+
+    size_t size() const {
+        return specimens_.size();
+    }
+
+    const Population<Specimen>& population() const {
+        return specimens_;
     }
 
     bool hasSolutions() const {
         return !solutions_.empty();
     }
 
+    /// Stop evolving. Safe to call from any thread, e.g. from a solution
+    /// callback or a timer. The generation being created is cut short after
+    /// the mate() call in progress, and evolve() returns
+    void cancel() {
+        cancelFlag_->store(true, std::memory_order_relaxed);
+    }
+
+    bool cancelled() const {
+        return cancelFlag_->load(std::memory_order_relaxed);
+    }
+
+    /// Clear the cancellation flag in use, e.g. to keep evolving after
+    /// stopOnFirstSolution cut a generation short. A generation cut short has
+    /// been promoted with its unmated slots, and is scored again in full
+    void resetCancellation() {
+        cancelFlag_->store(false, std::memory_order_relaxed);
+    }
+
+    /// Use flag instead of our own cancellation flag, so that cancelling any of
+    /// the generations sharing it (e.g. islands evolving in parallel) stops all
+    /// of them
+    void shareCancellation(std::atomic<bool>& flag) {
+        cancelFlag_ = &flag;
+    }
+
+    /// Max fitness score of the last generation
     unsigned maxScore() const {
-        return *(std::max_element(std::begin(fitnessScores_), std::end(fitnessScores_)));
+        return stats_.maxFitness_;
+    }
+
+    const GenerationStats& stats() const {
+        return stats_;
+    }
+
+    const PhaseStats& phaseStats() const {
+        return stats_.phases_;
+    }
+
+    /// Serialize everything needed to resume evolution from here into buffer
+    /// (see checkpoint.h)
+    void checkpoint(std::vector<char>& buffer) const requires TriviallyCopyableSpecimen<Specimen> {
+        auto engineState = detail::engineState(engine_);
+        auto randomState = detail::engineState(randomEngine());
+        detail::CheckpointHeader header;
+        header.specimenSize_ = sizeof(Specimen);
+        header.scored_ = scored_;
+        header.generation_ = stats_.generation_;
+        header.populationSize_ = specimens_.size();
+        header.engineStateSize_ = engineState.size();
+        header.randomStateSize_ = randomState.size();
+
+        buffer.clear();
+        detail::append(buffer, &header, sizeof(header));
+        detail::append(buffer, engineState.data(), engineState.size());
+        detail::append(buffer, randomState.data(), randomState.size());
+        detail::append(buffer, specimens_.data(), specimens_.size()*sizeof(Specimen));
+        if(scored_) {
+            auto fitnessScores = specimens_.fitness();
+            detail::append(buffer, fitnessScores.data(), fitnessScores.size()*sizeof(unsigned));
+        }
+    }
+
+    /// Resume from a checkpoint. Returns false, and leaves the generation as it
+    /// was, if it is not a valid checkpoint for this Specimen type
+    bool restore(std::span<const char> bytes) requires TriviallyCopyableSpecimen<Specimen> {
+        detail::CheckpointReader reader{bytes};
+        detail::CheckpointHeader header;
+        std::string engineState, randomState;
+        if(!reader.read(&header, sizeof(header))
+                || std::memcmp(header.magic_, header.expectedMagic, sizeof(header.magic_))
+                || header.version_ != header.currentVersion
+                || header.specimenSize_ != sizeof(Specimen)
+                || header.populationSize_ < 2
+                || !reader.read(engineState, header.engineStateSize_)
+                || !reader.read(randomState, header.randomStateSize_)) {
+            return false;
+        }
+        //Make sure the specimens (and their scores) are all there before
+        //making room for them
+        size_t bytesPerSpecimen = sizeof(Specimen) + (header.scored_ ? sizeof(unsigned) : 0);
+        if(header.populationSize_ > reader.remaining()/bytesPerSpecimen) {
+            return false;
+        }
+
+        Population<Specimen> specimens;
+        specimens.reserve(header.populationSize_);
+        alignas(Specimen) char storage[sizeof(Specimen)];
+        for(size_t i = 0; i < header.populationSize_; i++) {
+            if(!reader.read(storage, sizeof(storage))) {
+                return false;
+            }
+            specimens.emplace_back(*std::launder(reinterpret_cast<Specimen*>(storage)));
+        }
+        if(header.scored_) {
+            auto fitnessScores = specimens.resizeFitness();
+            if(!reader.read(fitnessScores.data(), fitnessScores.size()*sizeof(unsigned))) {
+                return false;
+            }
+        }
+        auto engine = engine_;
+        auto random = randomEngine();
+        if(!detail::setEngineState(engine, engineState) || !detail::setEngineState(random, randomState)) {
+            return false;
+        }
+
+        specimens_.swap(specimens);
+        children_.clear();
+        children_.reserve(specimens_.size());
+        parents_.clear();
+        spare_.reset();
+        scored_ = header.scored_;
+        stats_.generation_ = header.generation_;
+        engine_ = engine;
+        randomEngine() = random;
+        return true;
     }
 
-    void circleOfLife() {
-        scoreSpecimens().selectPairs().makeOffSprings().promote();
+    void circleOfLife() requires EvolvableSpecimen<Specimen> {
+        auto start = std::chrono::steady_clock::now();
+        stats_.phases_ = {};
+        scoreSpecimens().selectPairs().makeOffSprings();
+        if(!numMated_ && !parents_.empty()) {
+            //Cancelled before any child was mated, so there is no next
+            //generation and the specimens stay as they are
+            parents_.clear();
+            return;
+        }
+        promote();
+        auto end = std::chrono::steady_clock::now();
+        ++stats_.generation_;
+        stats_.duration_ = end - start;
+        stats_.elapsed_ = end - created_;
     }
 
 private:
 
     Generation& scoreSpecimens() {
-        std::for_each(std::begin(specimens_), std::end(specimens_),
-                      [this](auto&& specimen) {
-            fitnessScores_.push_back(score(specimen));
-        });
+        PhaseTimer timer{stats_.phases_, Phase::score};
+        detail::FitnessAccumulator accumulator;
+        auto cacheBefore = scored_ ? scoredCacheStats_ : cacheStats();
+        auto fitnessScores = specimens_.resizeFitness();
+        stats_.duplicateRatio_.reset();
+        if(scored_) {
+            //Scored by makeOffSprings
+        } else if constexpr (Config::collapseDuplicates) {
+            auto numDuplicates = duplicates_.find(specimens_.data(), specimens_.size(), SpecimenFingerprint<Specimen>{});
+            for(size_t i = 0; i < specimens_.size(); i++) {
+                //The first of identical specimens comes first, so it is already scored
+                auto original = duplicates_.original(i);
+                fitnessScores[i] = original == i ? fitness(specimens_[i]) : fitnessScores[original];
+            }
+            stats_.duplicateRatio_ = double(numDuplicates)/specimens_.size();
+        } else {
+            for(size_t i = 0; i < specimens_.size(); i++) {
+                fitnessScores[i] = fitness(specimens_[i]);
+            }
+        }
+        for(auto fitness : fitnessScores) {
+            accumulator.add(fitness);
+        }
+        accumulator.fill(stats_);
+
+        auto cacheAfter = cacheStats();
+        auto lookups = (cacheAfter.hits_ - cacheBefore.hits_) + (cacheAfter.misses_ - cacheBefore.misses_);
+        stats_.cacheHitRate_.reset();
+        if(lookups) {
+            stats_.cacheHitRate_ = double(cacheAfter.hits_ - cacheBefore.hits_)/lookups;
+        }
         return *this;
     }
 
+    /// Cumulative stats of the specimen's score cache, if it reports them
+    Memoizer::Stats cacheStats() const {
+        if constexpr (ScoreCacheStatsSpecimen<Specimen>) {
+            return scoreCacheStats(specimens_[0]);
+        } else {
+            return {};
+        }
+    }
+
+    /// Use the cached fitness if the specimen provides one, else score it
+    static unsigned fitness(const Specimen& specimen) {
+        if constexpr (CachedScoreSpecimen<Specimen>) {
+            if(auto cached = cachedScore(specimen)) {
+                return *cached;
+            }
+        }
+        return score(specimen);
+    }
+
     /// Select parents. More fit specimen will have a higher liklihood of
     /// being selected as a pair. The same specimen may mate with itself
     Generation& selectPairs() {
-        std::default_random_engine generator;
-        std::discrete_distribution<int> distribution{std::begin(fitnessScores_), std::end(fitnessScores_)};
-        for(int i = 0; i < specimens_.size(); i+=2) {
-            parents_.emplace_back(distribution(generator), distribution(generator));
+        PhaseTimer timer{stats_.phases_, Phase::select};
+        selection_.prepare(std::as_const(specimens_).fitness());
+        for(size_t i = Config::Replacement::numKept; i < specimens_.size(); i+=2) {
+            size_t first = selection_(engine_);
+            parents_.emplace_back(first, selection_(engine_));
         }
         return *this;
     }
 
+    /// Children are mated straight into their slot in children_. When the
+    /// population size leaves a single slot for the last pair of parents, the
+    /// second child goes to spare_ and is dropped once it has been looked at for
+    /// a solution
     Generation& makeOffSprings() {
+        PhaseTimer timer{stats_.phases_, Phase::offspring};
+        //The first generation has no slots yet
+        while(children_.size() < specimens_.size()) {
+            children_.emplace_back(specimens_[children_.size()]);
+        }
+        replacement_(std::as_const(specimens_), children_);
+
+        size_t slot = std::min(Config::Replacement::numKept, specimens_.size());
+        numMated_ = 0;
+        if constexpr (scoreOffSprings) {
+            scoredCacheStats_ = cacheStats();
+            auto childFitness = children_.resizeFitness();
+            for(size_t i = 0; i < slot; i++) {
+                childFitness[i] = fitness(children_[i]);
+            }
+        }
         for(const auto& mateIds : parents_) {
+            if(cancelled()) {
+                //The slots not yet mated keep specimens of an older generation
+                break;
+            }
             const Specimen& parent1 = specimens_[std::get<0>(mateIds)];
             const Specimen& parent2 = specimens_[std::get<1>(mateIds)];
-            Specimen child1{parent1}, child2{parent2};
-            std::tie(child1,child2) = mate(parent1,parent2);
-            for(const auto& child : {child1,child2}) {
-                if(solved(child)) {
-                    std::cout << "Found a solution : \n" << child << std::endl;
-                    solutions_.push_back(child);
-                    //Insert a random child to compensate for the specimen
-                    //that has evolved to perfection and has escaped
-                    children_.push_back(Specimen::random());
-                } else {
-                    children_.push_back(std::move(child));
-                }
+            bool lastSlot = slot + 1 == children_.size();
+            if(lastSlot && !spare_) {
+                spare_.emplace(parent2);
             }
+            Specimen& child1 = children_[slot];
+            Specimen& child2 = lastSlot ? *spare_ : children_[slot + 1];
+            mating_(parent1,parent2,child1,child2,engine_);
+            ++numMated_;
+            settleChild(slot);
+            if(!lastSlot) {
+                settleChild(slot + 1);
+            } else {
+                findSolution(child2);
+            }
+            slot += 2;
         }
         return *this;
     }
 
+    /// Look for a solution in a newly mated child and keep its score, if
+    /// children are scored as they are mated
+    void settleChild(size_t slot) {
+        Specimen& child = children_[slot];
+        auto childFitness = findSolution(child);
+        if constexpr (scoreOffSprings) {
+            children_.fitness()[slot] = childFitness ? *childFitness : fitness(child);
+        }
+    }
+
+    /// Record child if it is a solution, and replace it as per the config's
+    /// SolutionHandling. Specimens that declare their max fitness are solutions
+    /// when they score it, which saves the solved() check. Returns the fitness
+    /// of the child if it was computed along the way
+    std::optional<unsigned> findSolution(Specimen& child) {
+        std::optional<unsigned> childFitness;
+        bool isSolution{false};
+        if constexpr (DeclaredMaxFitnessSpecimen<Specimen>) {
+            childFitness = fitness(child);
+            isSolution = *childFitness >= Specimen::maxFitness;
+        } else {
+            isSolution = solved(child);
+        }
+
+        if(isSolution) {
+            solutions_.push_back(child);
+            if(onSolution_) {
+                onSolution_(solutions_.back());
+            }
+            //By default a random child is inserted to compensate for
+            //the specimen that has evolved to perfection and has escaped
+            child = solutionHandling_(solutions_.back());
+            childFitness.reset();
+            if constexpr (Config::stopOnFirstSolution) {
+                cancel();
+            }
+        }
+        return childFitness;
+    }
+
 
 };
 
-/// We stop when we have atleast one solution
-template<typename Specimen>
-void evolve(Generation<Specimen>& curr) {
-    int idx{0};
-    while(!curr.hasSolutions()) {
+/// We stop when we have atleast one solution, when evolution is cancelled, or once we have evolved
+/// maxGenerations generations if that is non zero. The stats of every generation
+/// are passed to sink. Returns the number of generations evolved
+template<EvolvableSpecimen Specimen, typename Config, typename Sink = PrintProgress>
+unsigned evolve(Generation<Specimen, Config>& curr, unsigned maxGenerations = 0, Sink&& sink = Sink{}) {
+    unsigned idx{0};
+    while(!curr.hasSolutions() && !curr.cancelled() && (!maxGenerations || idx < maxGenerations)) {
         curr.circleOfLife();
-        if(++idx % 1000 == 0) {
-            unsigned maxScore = curr.maxScore();
-            std::cout << "Generation : " << idx << ", maxScore = " << maxScore << std::endl;
-        }
+        ++idx;
+        sink(curr.stats());
     }
+    return idx;
 }
 
 }
@@ -0,0 +1,43 @@
+#ifdef EVOLVE_INSTRUMENT
+
+#include "instrument.h"
+#include <cstdlib>
+#include <new>
+
+/// Count every allocation for Evolve::PhaseStats. Only the plain and aligned forms
+/// need to be replaced, the array and nothrow forms call these
+void* operator new(std::size_t size) {
+    Evolve::allocationCount().fetch_add(1, std::memory_order_relaxed);
+    if(void* ptr = std::malloc(size ? size : 1)) {
+        return ptr;
+    }
+    throw std::bad_alloc{};
+}
+
+void operator delete(void* ptr) noexcept {
+    std::free(ptr);
+}
+
+void operator delete(void* ptr, std::size_t) noexcept {
+    std::free(ptr);
+}
+
+void* operator new(std::size_t size, std::align_val_t alignment) {
+    Evolve::allocationCount().fetch_add(1, std::memory_order_relaxed);
+    auto align = static_cast<std::size_t>(alignment);
+    //aligned_alloc() needs the size to be a multiple of the alignment
+    if(void* ptr = std::aligned_alloc(align, (size + align - 1)/align*align + (size ? 0 : align))) {
+        return ptr;
+    }
+    throw std::bad_alloc{};
+}
+
+void operator delete(void* ptr, std::align_val_t) noexcept {
+    std::free(ptr);
+}
+
+void operator delete(void* ptr, std::size_t, std::align_val_t) noexcept {
+    std::free(ptr);
+}
+
+#endif
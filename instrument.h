@@ -0,0 +1,94 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+
+/**
+ * \ingroup Evolve
+ *
+ * Optional per phase instrumentation of Evolve::Generation. It is compiled in
+ * only when EVOLVE_INSTRUMENT is defined (see the EVOLVE_INSTRUMENT CMake option),
+ * otherwise PhaseTimer is empty and the stats stay zero.
+ *
+ * Allocations are counted by the global operator new replacement in instrument.cpp,
+ * which is only compiled in along with the instrumentation.
+ */
+
+namespace Evolve {
+
+#ifdef EVOLVE_INSTRUMENT
+constexpr bool instrumented = true;
+#else
+constexpr bool instrumented = false;
+#endif
+
+/// The phases of Generation::circleOfLife
+enum class Phase { score, select, offspring, promote };
+constexpr size_t numPhases = 4;
+
+/// Number of calls to the global operator new so far
+inline std::atomic<std::uint64_t>& allocationCount() {
+    static std::atomic<std::uint64_t> count{0};
+    return count;
+}
+
+/// Wall time and number of allocations of each phase of the last generation
+struct PhaseStats {
+    std::array<std::uint64_t, numPhases> ns_{};
+    std::array<std::uint64_t, numPhases> allocations_{};
+
+    std::uint64_t ns(Phase phase) const {
+        return ns_[static_cast<size_t>(phase)];
+    }
+
+    std::uint64_t allocations(Phase phase) const {
+        return allocations_[static_cast<size_t>(phase)];
+    }
+};
+
+inline
+std::ostream& operator<<(std::ostream& os, const PhaseStats& stats) {
+    constexpr const char* names[numPhases] = {"score", "select", "offspring", "promote"};
+    for(size_t phase = 0; phase < numPhases; phase++) {
+        os << (phase ? ", " : "") << names[phase] << " = " << stats.ns_[phase] << "ns/"
+           << stats.allocations_[phase] << " allocs";
+    }
+    return os;
+}
+
+/// Adds the time and allocations from its construction to its destruction to
+/// the given phase
+class PhaseTimer {
+#ifdef EVOLVE_INSTRUMENT
+    PhaseStats& stats_;
+    size_t phase_;
+    std::chrono::steady_clock::time_point start_;
+    std::uint64_t startAllocations_;
+
+public:
+    PhaseTimer(PhaseStats& stats, Phase phase) :
+        stats_{stats},
+        phase_{static_cast<size_t>(phase)},
+        start_{std::chrono::steady_clock::now()},
+        startAllocations_{allocationCount().load(std::memory_order_relaxed)}
+    {}
+
+    ~PhaseTimer() {
+        stats_.allocations_[phase_] += allocationCount().load(std::memory_order_relaxed) - startAllocations_;
+        stats_.ns_[phase_] += std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    std::chrono::steady_clock::now() - start_).count();
+    }
+#else
+public:
+    PhaseTimer(PhaseStats&, Phase)
+    {}
+#endif
+
+    PhaseTimer(const PhaseTimer&) = delete;
+    PhaseTimer& operator=(const PhaseTimer&) = delete;
+};
+
+}
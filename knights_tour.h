@@ -7,6 +7,9 @@
 #include <ostream>
 #include "memoizer.h"
 #include <optional>
+#include <cstdint>
+#include <utility>
+#include <algorithm>
 
 extern std::default_random_engine& randomEngine();
 
@@ -66,6 +69,65 @@ struct Pos {
     {}
 };
 
+/// Sentinel for a move that leaves the board
+constexpr std::uint8_t noSquare = 0xFF;
+
+/// Index of a move within moves. The moves are looked up by their
+/// (rdelta, cdelta) pair in a 5x5 grid of deltas
+constexpr std::array<std::uint8_t,25> makeMovIndices() {
+    std::array<std::uint8_t,25> indices{};
+    std::uint8_t idx{0};
+    for(const auto& mov : moves) {
+        indices[(mov.rdelta_+2)*5 + mov.cdelta_+2] = idx++;
+    }
+    return indices;
+}
+
+constexpr auto movIndices = makeMovIndices();
+
+constexpr unsigned movIndex(const Mov& mov) {
+    return movIndices[(mov.rdelta_+2)*5 + mov.cdelta_+2];
+}
+
+/// Squares are numbered row*NumCols + col. targets[sq][idx] is the square reached
+/// by applying moves[idx] on sq, or noSquare if that leaves the board
+template<int NumRows, int NumCols>
+constexpr std::array<std::array<std::uint8_t,8>,NumRows*NumCols> makeMoveTargets() {
+    static_assert(NumRows*NumCols < noSquare, "Squares must fit in a byte");
+    std::array<std::array<std::uint8_t,8>,NumRows*NumCols> targets{};
+    for(int row = 0; row < NumRows; row++) {
+        for(int col = 0; col < NumCols; col++) {
+            std::uint8_t idx{0};
+            for(const auto& mov : moves) {
+                int newRow = row + mov.rdelta_;
+                int newCol = col + mov.cdelta_;
+                targets[row*NumCols + col][idx++] =
+                        newRow >= 0 && newRow < NumRows && newCol >= 0 && newCol < NumCols
+                        ? newRow*NumCols + newCol : noSquare;
+            }
+        }
+    }
+    return targets;
+}
+
+/// Random keys for Zobrist hashing of a tour of Length moves, keys[idx][movIdx]
+/// standing for moves[movIdx] being the idx'th move. Generated by splitmix64
+template<size_t Length>
+constexpr std::array<std::array<std::uint64_t,8>,Length> makeZobristKeys() {
+    std::array<std::array<std::uint64_t,8>,Length> keys{};
+    std::uint64_t state{0x9e3779b97f4a7c15ull};
+    for(auto& movKeys : keys) {
+        for(auto& key : movKeys) {
+            state += 0x9e3779b97f4a7c15ull;
+            std::uint64_t z = state;
+            z = (z ^ (z >> 30))*0xbf58476d1ce4e5b9ull;
+            z = (z ^ (z >> 27))*0x94d049bb133111ebull;
+            key = z ^ (z >> 31);
+        }
+    }
+    return keys;
+}
+
 /// Helper function to construct an array of N items obtained by the generating function
 /// f
 template<typename F, size_t... Is>
@@ -79,9 +141,33 @@ struct Tour {
     static constexpr auto numRows = 8;
     static constexpr auto numCols = 8;
     static constexpr auto startPos = Pos{4,4};
+    static constexpr auto numSquares = numRows*numCols;
+    static constexpr unsigned startSq = startPos.row_*numCols + startPos.col_;
+
+    /// Precomputed destination of every move from every square. Used where all the
+    /// moves from a square are scanned. Replaying a tour sticks to arithmetic since
+    /// it is latency bound and a table load on the dependency chain is slower than
+    /// the (well predicted) bounds checks
+    static constexpr auto moveTargets = makeMoveTargets<numRows,numCols>();
 
     std::array<Mov,length> tour_;
 
+    /// The score of a solved tour, see Evolve::DeclaredMaxFitnessSpecimen
+    static constexpr unsigned maxFitness = length;
+
+    /// Number of valid steps in tour_ when it is already known (extend() computes
+    /// it as a side effect) or unscored otherwise. Anything that modifies tour_
+    /// must reset this
+    static constexpr unsigned unscored = ~0u;
+    unsigned validSteps_ { unscored };
+
+    static constexpr auto zobristKeys = makeZobristKeys<length>();
+
+    /// Zobrist hash of tour_, the xor of zobristKeys[idx][movIndex(tour_[idx])]
+    /// over all the moves, so that changing a move updates it in O(1). Anything
+    /// that modifies tour_ must go through setMov() or call rehash()
+    std::uint64_t hash_ { 0 };
+
     /// An inner helper class that tracks the tour so far
     struct Board {
         unsigned board_[numRows][numCols];
@@ -110,6 +196,26 @@ struct Tour {
             }
         }
 
+        /// Same as above for a square looked up in moveTargets
+        std::optional<Pos> maybeApplyTarget(std::uint8_t sq) {
+            if (sq != noSquare && !visited(sq)) {
+                board_[sq/numCols][sq%numCols] = nextMovIdx++;
+                return Pos{sq/numCols, sq%numCols};
+            } else {
+                return std::nullopt;
+            }
+        }
+
+        bool visited(std::uint8_t sq) const {
+            return board_[sq/numCols][sq%numCols] != 0;
+        }
+
+        /// Take back the last move, which landed on sq
+        void undo(std::uint8_t sq) {
+            board_[sq/numCols][sq%numCols] = 0;
+            --nextMovIdx;
+        }
+
         /// Apply the tour for as long as possible. Note that not all
         /// tours are valid so in general only a prefix of the tour
         /// will be applicable before we run into a deadend
@@ -130,8 +236,32 @@ struct Tour {
         }
     };
 
-    Tour(const std::array<Mov,length>& other) : tour_{other}
-    {}
+    Tour(const std::array<Mov,length>& other) : tour_{other} {
+        rehash();
+    }
+
+    void rehash() {
+        hash_ = 0;
+        for(size_t idx = 0; idx < length; idx++) {
+            hash_ ^= zobristKeys[idx][movIndex(tour_[idx])];
+        }
+    }
+
+    /// Replace the move at idx
+    void setMov(size_t idx, const Mov& mov) {
+        hash_ ^= zobristKeys[idx][movIndex(tour_[idx])] ^ zobristKeys[idx][movIndex(mov)];
+        tour_[idx] = mov;
+    }
+
+    /// The hash of a tour that takes the moves in [begin, end) from other
+    /// instead of from this tour. Moves the two tours share cancel out
+    std::uint64_t hashWithMovesOf(const Tour& other, size_t begin, size_t end) const {
+        std::uint64_t hash{hash_};
+        for(size_t idx = begin; idx < end; idx++) {
+            hash ^= zobristKeys[idx][movIndex(tour_[idx])] ^ zobristKeys[idx][movIndex(other.tour_[idx])];
+        }
+        return hash;
+    }
 
     unsigned numValidSteps() const {
         Board board;
@@ -192,11 +322,25 @@ std::ostream& operator<<(std::ostream& os, const Tour& t) {
     return os;
 }
 
-/// The fitness function of the specimen
-/// The fittest specimen will have a score of 63
-/// corresponding to a solved Tour
+/// Optional Specimen hook returning a hash of the moves of a tour, see
+/// Evolve::FingerprintSpecimen. The hash is kept up to date as the tour changes,
+/// so this does not look at the moves
 inline
-unsigned score(const Tour& t) {
+std::uint64_t fingerprint(const Tour& t) {
+    return t.hash_;
+}
+
+/// Fingerprint of the moves of a tour, leaving out the cached validSteps_, for
+/// caches keyed by fingerprints (see mapped_cache.h)
+struct TourFingerprint {
+    std::uint64_t operator()(const Tour& t) const {
+        return fingerprint(t);
+    }
+};
+
+/// The memoizing cache behind score()
+inline
+auto& scoreMemoizer() {
 
     /// This is the actual fitness function
     auto realScore = [](const Tour& t) {
@@ -204,47 +348,200 @@ unsigned score(const Tour& t) {
     };
 
     /// We memoize the call since we might be evaulating the same tour multiple
-    /// times
-    using CacheT = Memoizer::Cache<decltype(realScore), std::decay_t<decltype(t)>>;
+    /// times. The cache is keyed by the hash of the tour (see TourFingerprint),
+    /// which is already known, rather than by the moves
+    using CacheT = Memoizer::FingerprintCache<decltype(realScore), Tour, TourFingerprint>;
     static Memoizer::Memoizer<CacheT, decltype(realScore)> memoizer_s{realScore};
 
-    return memoizer_s(t);
+    return memoizer_s;
 }
 
+/// The fitness function of the specimen
+/// The fittest specimen will have a score of 63
+/// corresponding to a solved Tour
 inline
-std::tuple<Tour, Tour> cross(const Tour& first, const Tour& second, size_t crossPoint) {
+unsigned score(const Tour& t) {
+    return scoreMemoizer()(t);
+}
 
-    Tour child1{first}, child2{second};
+/// Optional Specimen hook that reports how often score() was served from
+/// its memoizing cache
+inline
+Memoizer::Stats scoreCacheStats(const Tour&) {
+    return scoreMemoizer().stats_;
+}
+
+/// Optional Specimen hook used by Evolve::Generation to skip scoring
+/// specimens whose fitness is already known
+inline
+std::optional<unsigned> cachedScore(const Tour& t) {
+    if(t.validSteps_ == Tour::unscored) {
+        return std::nullopt;
+    }
+    return t.validSteps_;
+}
+
+/// Create the two children of a cross directly in child1 and child2. Their
+/// hashes are derived from the parents' over the shorter of the two parts of
+/// the tours, so a cross near either end is cheap to hash
+inline
+void crossInto(const Tour& first, const Tour& second, size_t crossPoint, Tour& child1, Tour& child2) {
+    //child1 is first with the tail of second, or equally second with the head of
+    //first. Between them the children have every move of both parents
+    std::uint64_t hash1 = crossPoint < Tour::length - crossPoint
+            ? second.hashWithMovesOf(first, 0, crossPoint)
+            : first.hashWithMovesOf(second, crossPoint, Tour::length);
+    std::uint64_t hash2 = hash1 ^ first.hash_ ^ second.hash_;
+    std::copy(std::begin(first.tour_), std::begin(first.tour_)+crossPoint, std::begin(child1.tour_));
     std::copy(std::begin(second.tour_)+crossPoint, std::end(second.tour_), std::begin(child1.tour_)+crossPoint);
+    std::copy(std::begin(second.tour_), std::begin(second.tour_)+crossPoint, std::begin(child2.tour_));
     std::copy(std::begin(first.tour_)+crossPoint, std::end(first.tour_), std::begin(child2.tour_)+crossPoint);
+    child1.validSteps_ = child2.validSteps_ = Tour::unscored;
+    child1.hash_ = hash1;
+    child2.hash_ = hash2;
+}
 
+inline
+std::tuple<Tour, Tour> cross(const Tour& first, const Tour& second, size_t crossPoint) {
+
+    Tour child1{first}, child2{second};
+    crossInto(first, second, crossPoint, child1, child2);
     return {child1,child2};
 
 }
 
 inline
-Tour mutate(const Tour& tour) {
+void mutateInPlace(Tour& tour) {
     static std::uniform_int_distribution<uint8_t> distribution1(0,7);
-    static std::uniform_int_distribution<unsigned> distribution2(0,63);
+    static std::uniform_int_distribution<unsigned> distribution2(0,Tour::length-1);
 
     //select a random point and mutate it
-    Tour mutated{tour};
     unsigned step = distribution2(randomEngine());
     Mov mov = *(std::cbegin(moves) + distribution1(randomEngine()));
-    mutated.tour_[step] = mov;
+    tour.setMov(step, mov);
+    tour.validSteps_ = Tour::unscored;
+}
+
+inline
+Tour mutate(const Tour& tour) {
+    Tour mutated{tour};
+    mutateInPlace(mutated);
     return mutated;
 }
 
+/// Settings for the optional backtracking repair done by extend() when it runs
+/// into a dead end. Repair undoes upto maxDepth_ moves and runs a depth first
+/// search for a longer tour from there. All the repairs done by a single extend()
+/// call share a budget of nodeBudget_ moves tried. Repair is disabled when either
+/// of them is 0, which is the default
+struct RepairOptions {
+    unsigned maxDepth_{0};
+    unsigned nodeBudget_{0};
+
+    bool enabled() const {
+        return maxDepth_ && nodeBudget_;
+    }
+};
+
+namespace detail {
+
+/// Depth first search for the longest tour continuing from a given step. Moves
+/// are tried in the order of Warnsdorff's heuristic (fewest onward moves first)
+struct Repairer {
+    using Squares = std::array<std::uint8_t, Tour::length+1>;
+
+    Tour::Board& board_;
+    unsigned& budget_;
+    Squares curr_;
+    Squares best_;
+    size_t bestLen_{0};
+
+    void search(size_t idx) {
+        if(idx > bestLen_) {
+            bestLen_ = idx;
+            best_ = curr_;
+        }
+        if(idx == Tour::length) {
+            return;
+        }
+
+        std::array<std::uint8_t,8> candidates, degrees;
+        size_t numCandidates{0};
+        for(auto target : Tour::moveTargets[curr_[idx]]) {
+            if(target == noSquare || board_.visited(target)) {
+                continue;
+            }
+            std::uint8_t degree{0};
+            for(auto onward : Tour::moveTargets[target]) {
+                degree += onward != noSquare && !board_.visited(onward);
+            }
+            size_t pos = numCandidates++;
+            for(; pos > 0 && degrees[pos-1] > degree; pos--) {
+                candidates[pos] = candidates[pos-1];
+                degrees[pos] = degrees[pos-1];
+            }
+            candidates[pos] = target;
+            degrees[pos] = degree;
+        }
+
+        for(size_t i = 0; i < numCandidates && budget_ && bestLen_ < Tour::length; i++) {
+            --budget_;
+            board_.maybeApplyTarget(candidates[i]);
+            curr_[idx+1] = candidates[i];
+            search(idx+1);
+            board_.undo(candidates[i]);
+        }
+    }
+};
+
+}
+
+/// Called by extend() when no move is possible after idx steps. squares holds the
+/// squares visited so far (squares[0] is the start). Undo upto maxDepth_ steps and
+/// search for a longer tour. If one is found, the tail of the tour is rewritten.
+/// Returns the number of valid steps, with board updated to match
+inline
+size_t repair(Tour& tour, Tour::Board& board, detail::Repairer::Squares& squares,
+              size_t idx, unsigned maxDepth, unsigned& budget) {
+    size_t base = idx - std::min<size_t>(idx, maxDepth);
+    for(size_t i = idx; i > base; i--) {
+        board.undo(squares[i]);
+    }
+
+    detail::Repairer repairer{board, budget, squares, squares, 0};
+    repairer.search(base);
+
+    if(repairer.bestLen_ > idx) {
+        for(size_t i = base; i < repairer.bestLen_; i++) {
+            const auto& targets = Tour::moveTargets[repairer.best_[i]];
+            auto movIdx = std::find(std::begin(targets), std::end(targets), repairer.best_[i+1]) - std::begin(targets);
+            tour.setMov(i, *(std::cbegin(moves) + movIdx));
+        }
+        squares = repairer.best_;
+        idx = repairer.bestLen_;
+    }
+    for(size_t i = base; i < idx; i++) {
+        board.maybeApplyTarget(squares[i+1]);
+    }
+    return idx;
+}
+
 /// It can be seen from the Genetics Algo literature that just crossover and mutation
 /// are not enough to generate valid solutions to this problem when using discretized
 /// evolution. A common approach suggested is to extend the semantics of mutation
 /// with "nurture" - i.e. increase the fitness of a child. To do this
 /// we fix up a child specimen so that it has a longer valid prefix tour.
+/// If repair is enabled in options, dead ends are backtracked out of.
+/// Since we walk the whole valid prefix anyway, the number of valid steps is
+/// cached in the returned tour so that it does not need to be replayed again
+/// when scoring
 inline
-Tour extend(const Tour& t) {
+void extendInPlace(Tour& tour, const RepairOptions& options = {}) {
 
-    Tour tour{t};
     Tour::Board board;
+    unsigned budget{options.enabled() ? options.nodeBudget_ : 0};
+    detail::Repairer::Squares squares;
+    squares[0] = Tour::startSq;
 
     Pos pos{Tour::startPos};
     for(size_t idx = 0; idx < Tour::length; idx++) {
@@ -255,21 +552,38 @@ Tour extend(const Tour& t) {
             bool extended = false;
             /// Todo: Apply Warnsdorff's heuristic to select a move from
             /// multiple applicable moves
-            for(const auto& mov : moves) {
-                newPos = board.maybeApplyMove(pos,mov);
+            const auto& targets = Tour::moveTargets[pos.row_*Tour::numCols + pos.col_];
+            for(unsigned movIdx = 0; movIdx < targets.size(); movIdx++) {
+                newPos = board.maybeApplyTarget(targets[movIdx]);
                 if(newPos) {
                     pos = *newPos;
-                    tour.tour_[idx] = mov;
+                    tour.setMov(idx, *(std::cbegin(moves) + movIdx));
                     extended = true;
                     break;
                 }
             }
+            if(!extended && budget) {
+                size_t numSteps = repair(tour, board, squares, idx, options.maxDepth_, budget);
+                if(numSteps > idx) {
+                    pos = Pos{squares[numSteps]/Tour::numCols, squares[numSteps]%Tour::numCols};
+                    idx = numSteps - 1;
+                    continue;
+                }
+            }
             if(!extended) {
                 break;
             }
         }
+        squares[idx+1] = pos.row_*Tour::numCols + pos.col_;
     }
 
+    tour.validSteps_ = board.numMoves();
+}
+
+inline
+Tour extend(const Tour& t, const RepairOptions& options = {}) {
+    Tour tour{t};
+    extendInPlace(tour, options);
     return tour;
 }
 
@@ -289,6 +603,38 @@ std::tuple<Tour, Tour> mate(const Tour& first, const Tour& second) {
     return {extend(mutate(std::get<0>(children))), extend(mutate(std::get<1>(children)))};
 }
 
+/// Same as above, but the children are written into child1 and child2 instead
+/// of being returned, so that Evolve::Generation can mate straight into the
+/// next generation. The children are extended with the given repair options
+inline
+void mate(const Tour& first, const Tour& second, Tour& child1, Tour& child2, const RepairOptions& options = {}) {
+
+    static std::uniform_int_distribution<unsigned> distribution(0,Tour::length);
+    crossInto(first, second, distribution(randomEngine()), child1, child2);
+    mutateInPlace(child1);
+    extendInPlace(child1, options);
+    mutateInPlace(child2);
+    extendInPlace(child2, options);
+}
+
+/// Mating policy (see Evolve::DefaultConfig) that mates like mate() and repairs
+/// the children as per options_. Each Generation holds its own, so generations
+/// evolving side by side can repair differently
+///
+///     struct RepairConfig : Evolve::DefaultConfig {
+///         using Mating = KnightsTour::MateWithRepair;
+///     };
+///     Evolve::Generation<KnightsTour::Tour, RepairConfig> generation{tours};
+///     generation.mating().options_ = {8, 1000};
+struct MateWithRepair {
+    RepairOptions options_;
+
+    template<typename Rng>
+    void operator()(const Tour& first, const Tour& second, Tour& child1, Tour& child2, Rng&) const {
+        mate(first, second, child1, child2, options_);
+    }
+};
+
 inline
 bool solved(const Tour& t) {
     return t.solved();
@@ -1,23 +1,54 @@
 #include "evolve.h"
 #include "nqueens.h"
 #include "knights_tour.h"
+#include "tiled_tour.h"
+#include "solution_reporter.h"
 #include <iterator>
 
+/// Tours are mated by a policy that holds the repair options
+struct KnightsTourConfig : Evolve::DefaultConfig {
+    using Mating = KnightsTour::MateWithRepair;
+};
+
+/// Solutions are printed on the reporter thread, off the evolution path
+auto printSolution = [](const auto& solution) {
+    std::cout << "Found a solution : \n" << solution << std::endl;
+};
+
 int main(int argc, char** argv) {
 
     if(argc > 1 && std::string(argv[1]) == "nqueens" ) {
         //Start off with 50 boards.
         std::vector<NQueens::Board> initialBoards;
         std::generate_n(std::back_inserter(initialBoards),50,NQueens::Board::random);
+        Evolve::SolutionReporter<NQueens::Board> reporter{printSolution};
         Evolve::Generation<NQueens::Board> seedGeneration{std::move(initialBoards)};
+        seedGeneration.setSolutionCallback(std::ref(reporter));
         Evolve::evolve(seedGeneration);
     } else if(argc > 1 && std::string(argv[1]) == "knightstour"){
         //Start off with 50 tours.
         std::vector<KnightsTour::Tour> initialTours;
         std::generate_n(std::back_inserter(initialTours),50,KnightsTour::Tour::random);
-        Evolve::Generation<KnightsTour::Tour> seedGeneration{std::move(initialTours)};
+        Evolve::SolutionReporter<KnightsTour::Tour> reporter{printSolution};
+        Evolve::Generation<KnightsTour::Tour, KnightsTourConfig> seedGeneration{std::move(initialTours)};
+        seedGeneration.setSolutionCallback(std::ref(reporter));
+        //Optionally backtrack out of dead ends when extending tours
+        if(argc > 2) {
+            seedGeneration.mating().options_.maxDepth_ = std::stoi(argv[2]);
+            seedGeneration.mating().options_.nodeBudget_ = argc > 3 ? std::stoi(argv[3]) : 1000;
+        }
         Evolve::evolve(seedGeneration);
+    } else if(argc > 1 && std::string(argv[1]) == "tiledtour"){
+        //Large boards are tiled into sub-boards that are solved in parallel
+        int numRows = argc > 2 ? std::stoi(argv[2]) : 100;
+        int numCols = argc > 3 ? std::stoi(argv[3]) : numRows;
+        auto tour = TiledTour::solve(numRows, numCols, randomEngine()());
+        if(tour) {
+            std::cout << "Found a solution : \n" << *tour << std::endl;
+        } else {
+            std::cout << "Could not find a tour for a " << numRows << "x" << numCols << " board\n";
+        }
     } else {
-        std::cout << "Usage: \n evolve [nqueens|knightstour]\n";
+        std::cout << "Usage: \n evolve [nqueens|knightstour [repairDepth [repairBudget]]|tiledtour [rows [cols]]]\n";
     }
 }
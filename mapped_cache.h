@@ -0,0 +1,214 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <optional>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "memoizer.h"
+
+/**
+ * \ingroup Evolve
+ *
+ * A Memoizer cache backend stored in a memory mapped file, so that memoized
+ * results survive the process and are shared by all the processes using the
+ * same file. Use it in place of Memoizer::Cache
+ *
+ *     using CacheT = Memoizer::MappedCache<decltype(realScore), Tour, KnightsTour::TourFingerprint>;
+ *     Memoizer::Memoizer<CacheT, decltype(realScore)> memoizer{realScore, CacheT{"scores.cache", 1 << 20}};
+ *
+ * The file is a fixed size open addressed table mapping a 64 bit fingerprint of
+ * the key to the result. Keys are not stored, so two keys with the same
+ * fingerprint share a result. Once the probes for a key find no free slot its
+ * result is not cached. Slots are claimed and filled with atomic operations, so
+ * concurrent processes (and threads) can read and add results without locking.
+ *
+ * Results must be integers of upto 32 bits. Linux only.
+ */
+
+namespace Memoizer {
+
+template<typename F, typename Key, typename Fingerprint = BytesFingerprint<Key>>
+class MappedCache {
+public:
+    using val_t = std::invoke_result_t<F, const Key&>;
+    static_assert(std::is_integral_v<val_t> && sizeof(val_t) <= 4, "Results must fit in 32 bits");
+
+    /// Number of slots looked at for a key before giving up
+    static constexpr std::size_t maxProbes = 16;
+
+private:
+    struct alignas(64) Header {
+        char magic_[4];
+        std::uint32_t version_;
+        std::uint64_t capacity_;
+    };
+
+    /// fingerprint_ is 0 in a free slot. value_ is (result << 1) | 1 once the
+    /// result is stored, since a slot is claimed before its result is written
+    struct Slot {
+        std::uint64_t fingerprint_;
+        std::uint64_t value_;
+    };
+
+    static_assert(std::atomic_ref<std::uint64_t>::is_always_lock_free, "Slots are shared between processes");
+
+    static constexpr char magic[4] = {'E','V','M','C'};
+    static constexpr std::uint32_t version = 1;
+
+    void* mapping_{nullptr};
+    std::size_t mappedSize_{0};
+    Slot* slots_{nullptr};
+    std::uint64_t mask_{0};
+    Fingerprint fingerprint_;
+
+    static std::size_t fileSize(std::uint64_t capacity) {
+        return sizeof(Header) + capacity*sizeof(Slot);
+    }
+
+    std::uint64_t fingerprintOf(const Key& key) const {
+        auto fingerprint = fingerprint_(key);
+        return fingerprint ? fingerprint : 1;
+    }
+
+    void unmap() {
+        if(mapping_) {
+            ::munmap(mapping_, mappedSize_);
+        }
+        mapping_ = nullptr;
+        slots_ = nullptr;
+    }
+
+public:
+    /// Map the table in the file at path, creating it with capacity slots
+    /// (rounded up to a power of 2) if it does not exist. An existing table
+    /// keeps its capacity. If the file can not be used, e.g. it holds something
+    /// else, the cache stays empty and every lookup misses
+    MappedCache(const std::string& path, std::size_t capacity) {
+        std::uint64_t numSlots{1};
+        while(numSlots < capacity) {
+            numSlots <<= 1;
+        }
+
+        int fd = ::open(path.c_str(), O_RDWR | O_CREAT, 0644);
+        if(fd < 0) {
+            return;
+        }
+        //Serialize creating the table with other processes
+        ::flock(fd, LOCK_EX);
+        struct stat st;
+        Header header{};
+        std::size_t size{0};
+        //A file that can not be stat'ed is left alone, with size 0
+        bool statted = ::fstat(fd, &st) == 0;
+        if(statted && st.st_size == 0) {
+            std::memcpy(header.magic_, magic, sizeof(magic));
+            header.version_ = version;
+            header.capacity_ = numSlots;
+            if(::ftruncate(fd, fileSize(numSlots)) == 0 && ::pwrite(fd, &header, sizeof(header), 0) == sizeof(header)) {
+                size = fileSize(numSlots);
+            }
+        } else if(statted && ::pread(fd, &header, sizeof(header), 0) == sizeof(header)) {
+            size = st.st_size;
+        }
+
+        bool valid = !std::memcmp(header.magic_, magic, sizeof(magic)) && header.version_ == version
+                && header.capacity_ && !(header.capacity_ & (header.capacity_ - 1))
+                && size == fileSize(header.capacity_);
+        if(valid) {
+            void* mapping = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+            if(mapping != MAP_FAILED) {
+                mapping_ = mapping;
+                mappedSize_ = size;
+                slots_ = reinterpret_cast<Slot*>(static_cast<char*>(mapping) + sizeof(Header));
+                mask_ = header.capacity_ - 1;
+            }
+        }
+        ::flock(fd, LOCK_UN);
+        ::close(fd);
+    }
+
+    ~MappedCache() {
+        unmap();
+    }
+
+    MappedCache(MappedCache&& other) :
+        mapping_{std::exchange(other.mapping_, nullptr)},
+        mappedSize_{other.mappedSize_},
+        slots_{std::exchange(other.slots_, nullptr)},
+        mask_{other.mask_},
+        fingerprint_{std::move(other.fingerprint_)}
+    {}
+
+    MappedCache& operator=(MappedCache&& other) {
+        if(this != &other) {
+            unmap();
+            mapping_ = std::exchange(other.mapping_, nullptr);
+            mappedSize_ = other.mappedSize_;
+            slots_ = std::exchange(other.slots_, nullptr);
+            mask_ = other.mask_;
+            fingerprint_ = std::move(other.fingerprint_);
+        }
+        return *this;
+    }
+
+    MappedCache(const MappedCache&) = delete;
+    MappedCache& operator=(const MappedCache&) = delete;
+
+    bool mapped() const {
+        return mapping_;
+    }
+
+    std::size_t capacity() const {
+        return mapping_ ? mask_ + 1 : 0;
+    }
+
+    std::optional<val_t> lookup(const Key& key) const {
+        if(!slots_) {
+            return std::nullopt;
+        }
+        auto fingerprint = fingerprintOf(key);
+        for(std::size_t probe = 0; probe < maxProbes; probe++) {
+            Slot& slot = slots_[(fingerprint + probe) & mask_];
+            auto slotFingerprint = std::atomic_ref<std::uint64_t>{slot.fingerprint_}.load(std::memory_order_acquire);
+            if(slotFingerprint == fingerprint) {
+                auto value = std::atomic_ref<std::uint64_t>{slot.value_}.load(std::memory_order_acquire);
+                if(value & 1) {
+                    return static_cast<val_t>(value >> 1);
+                }
+                return std::nullopt;
+            }
+            if(!slotFingerprint) {
+                return std::nullopt;
+            }
+        }
+        return std::nullopt;
+    }
+
+    void store(val_t v, const Key& key) {
+        if(!slots_) {
+            return;
+        }
+        auto fingerprint = fingerprintOf(key);
+        for(std::size_t probe = 0; probe < maxProbes; probe++) {
+            Slot& slot = slots_[(fingerprint + probe) & mask_];
+            std::uint64_t expected{0};
+            if(std::atomic_ref<std::uint64_t>{slot.fingerprint_}.compare_exchange_strong(expected, fingerprint,
+                                                                                        std::memory_order_acq_rel)
+                    || expected == fingerprint) {
+                auto value = (static_cast<std::uint64_t>(static_cast<std::make_unsigned_t<val_t>>(v)) << 1) | 1;
+                std::atomic_ref<std::uint64_t>{slot.value_}.store(value, std::memory_order_release);
+                return;
+            }
+        }
+    }
+};
+
+}
@@ -1,9 +1,14 @@
 #pragma once
 
 #include <map>
+#include <unordered_map>
 #include <tuple>
 #include <type_traits>
 #include <optional>
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <utility>
 
 /**
  * \ingroup Evolve
@@ -15,14 +20,51 @@
  * of the argument types of the function and the mapped_type is the type of the result
  * computed by the memozied function
  *
- * See the score() functions in knights_tour.h and nqueens.h to see usage examples
+ * See the score() functions in knights_tour.h and nqueens.h to see usage examples,
+ * and mapped_cache.h for a cache that persists across runs
  */
 namespace Memoizer {
 
+/// 64 bit hash of the bytes, mixing in 8 bytes at a time, followed by a final
+/// avalanche so that the low bits used to index a table depend on every byte
+inline
+std::uint64_t fingerprintBytes(const void* data, std::size_t size) {
+    constexpr std::uint64_t multiplier{0xff51afd7ed558ccdull};
+    auto bytes = static_cast<const unsigned char*>(data);
+    std::uint64_t hash{0x9e3779b97f4a7c15ull ^ size};
+    for(std::size_t i = 0; i < size; i += sizeof(std::uint64_t)) {
+        std::uint64_t word{0};
+        std::memcpy(&word, bytes + i, std::min(sizeof(word), size - i));
+        hash = (hash ^ word)*multiplier;
+        hash ^= hash >> 32;
+    }
+    hash ^= hash >> 33;
+    hash *= 0xc4ceb9fe1a85ec53ull;
+    hash ^= hash >> 33;
+    return hash;
+}
+
+/// Fingerprint of the object representation of a key. Only for keys without
+/// padding or other bytes that do not take part in their value
+template<typename Key>
+struct BytesFingerprint {
+    static_assert(std::has_unique_object_representations_v<Key>, "Provide a fingerprint that skips padding");
+
+    std::uint64_t operator()(const Key& key) const {
+        return fingerprintBytes(&key, sizeof(key));
+    }
+};
+
+/// Number of calls answered from the cache (hits_) and computed (misses_)
+struct Stats {
+    std::uint64_t hits_{0};
+    std::uint64_t misses_{0};
+};
+
 template<typename F, typename... Args>
 struct Cache {
     using key_t = std::tuple<std::decay_t<Args>...>;
-    using val_t = std::result_of_t<F&& (Args&&...)>;
+    using val_t = std::invoke_result_t<F, Args...>;
     std::map<key_t,val_t> cache_;
 
     void store(val_t v, Args... args) {
@@ -39,21 +81,55 @@ struct Cache {
     }
 };
 
+/// A cache keyed by a 64 bit fingerprint of the key rather than by the key,
+/// for keys that are slow to compare but cheap to fingerprint, e.g. because
+/// they keep a hash of themselves up to date. Keys are not stored, so two keys
+/// with the same fingerprint share a result
+template<typename F, typename Key, typename Fingerprint = BytesFingerprint<Key>>
+struct FingerprintCache {
+    using val_t = std::invoke_result_t<F, const Key&>;
+    std::unordered_map<std::uint64_t, val_t> cache_;
+    Fingerprint fingerprint_;
+
+    void store(val_t v, const Key& key) {
+        cache_[fingerprint_(key)] = v;
+    }
+
+    std::optional<val_t> lookup(const Key& key) const {
+        std::optional<val_t> result;
+        auto itr = cache_.find(fingerprint_(key));
+        if(itr != cache_.end()) {
+            result = itr->second;
+        }
+        return result;
+    }
+};
+
 template<typename CacheT, typename CallableT>
 struct Memoizer{
     mutable CacheT cache_;
+    mutable Stats stats_;
     CallableT fn_;
 
     Memoizer(const CallableT& callable) :
         fn_{callable}
     {}
 
+    /// For caches that need setting up, e.g. a MappedCache
+    Memoizer(const CallableT& callable, CacheT cache) :
+        cache_{std::move(cache)},
+        fn_{callable}
+    {}
+
     template<typename... Args>
     auto operator()(Args... args) const {
         auto res = cache_.lookup(args...);
         if(!res) {
+            ++stats_.misses_;
             res = fn_(args...);
             cache_.store(*res,args...);
+        } else {
+            ++stats_.hits_;
         }
         return *res;
     }
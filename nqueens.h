@@ -1,6 +1,7 @@
 #pragma once
 
 #include <array>
+#include <cassert>
 #include <tuple>
 #include <random>
 #include <cmath>
@@ -33,21 +34,58 @@ auto make_array(F&& f, std::index_sequence<Is...>) -> std::array<decltype(f()),s
     return {((void)Is,f())...};
 }
 
-/// A sequence of 8 numbers, each representing the position of a queen on a chessboard
+/// A sequence of 8 numbers, each representing the position of a queen on a chessboard.
+/// The positions are packed into one integer, so that crossing over is a blend of
+/// two integers under a mask, a mutation rewrites a bit field and comparing boards
+/// compares integers
 struct Board {
-    std::array<std::uint8_t, 8> board_;
+    static constexpr size_t length = 8;
 
-    Board(const Board& board) : board_{board.board_}
-    {}
+    /// The score of a solved board, see Evolve::DeclaredMaxFitnessSpecimen
+    static constexpr unsigned maxFitness = 28;
 
-    Board(const std::array<std::uint8_t, 8>& b) : board_{b}
-    {}
+    /// Bits used for the position on each column
+    static constexpr unsigned bitsPerPos = 3;
+    static constexpr std::uint32_t posMask = (1u << bitsPerPos) - 1;
+
+    /// The position on column i is in bits [3i, 3i+3)
+    std::uint32_t board_;
+
+    Board(const std::array<std::uint8_t, 8>& b) : board_{0} {
+        for(size_t i = 0; i < length; i++) {
+            set(i, b[i]);
+        }
+    }
+
+    /// The board with the given index(), i.e. the given packed positions
+    static Board fromIndex(std::uint32_t idx) {
+        Board board{{}};
+        board.board_ = idx;
+        return board;
+    }
+
+    /// The position of the queen on column col
+    unsigned operator[](size_t col) const {
+        return (board_ >> (bitsPerPos*col)) & posMask;
+    }
+
+    /// Place the queen on column col at pos, which must be less than 8. Only
+    /// the low 3 bits of pos are kept, so that other columns are never touched
+    void set(size_t col, unsigned pos) {
+        assert(col < length && pos <= posMask);
+        auto shift = bitsPerPos*col;
+        board_ = (board_ & ~(posMask << shift)) | ((static_cast<std::uint32_t>(pos) & posMask) << shift);
+    }
 
     unsigned numAttackingPairs() const {
+        std::array<int, length> pos;
+        for(size_t i = 0; i < length; i++) {
+            pos[i] = (*this)[i];
+        }
         unsigned count{0};
         for(int i = 0; i < 8; i++)
             for(int j = i+1; j < 8; j++)  {
-                if( (board_[i] == board_[j]) || (std::abs(board_[j] - board_[i]) == j-i) ) {
+                if( (pos[i] == pos[j]) || (std::abs(pos[j] - pos[i]) == j-i) ) {
                     ++count;
                 }
             }
@@ -58,14 +96,19 @@ struct Board {
         return numAttackingPairs() == 0;
     }
 
+    /// Every board as a distinct 24 bit number, 3 bits per column with the
+    /// first column in the low bits. See FitnessTable
+    std::uint32_t index() const {
+        return board_;
+    }
+
     /// Ordering function needed because we store boards in a memoizing cache
     bool operator< (const Board& rhs) const {
-        for(size_t i = 0; i < board_.size(); i++) {
-            if(board_[i] != rhs.board_[i]) {
-                return board_[i] < rhs.board_[i];
-            }
-        }
-        return false;
+        return board_ < rhs.board_;
+    }
+
+    bool operator== (const Board& rhs) const {
+        return board_ == rhs.board_;
     }
 
     static Board random() {
@@ -83,42 +126,65 @@ struct Board {
 inline
 std::ostream& operator<<(std::ostream& os, const Board& b) {
     os << "[";
-    for(const auto& pos : b.board_) {
-        os << (unsigned)pos << ',';
+    for(size_t col = 0; col < Board::length; col++) {
+        os << b[col] << ',';
     }
     os << "]\n";
     return os;
 }
 
 
-/// The fitness function of the specimen.
-/// We have 8C2 = 28 possible attacking pairs
-/// The fittest specimen will have 0 attacking pairs
+/// The memoizing cache behind score()
 inline
-unsigned score(const Board& b) {
+auto& scoreMemoizer() {
 
     /// This is the actual fitness function
-    auto realScore = [](const Board& b) {
-        return 28 - b.numAttackingPairs();
+    auto realScore = [](std::uint32_t idx) {
+        return 28 - Board::fromIndex(idx).numAttackingPairs();
     };
 
     /// We memoize the call since we might be evaulating the same board multiple
-    /// times
-    using CacheT =  Memoizer::Cache<decltype(realScore), std::decay_t<decltype(b)>>;
+    /// times. The packed board is the key
+    using CacheT = Memoizer::Cache<decltype(realScore), std::uint32_t>;
     static Memoizer::Memoizer<CacheT, decltype(realScore)> memoizer_s{realScore};
 
-    return memoizer_s(b);
+    return memoizer_s;
+}
+
+/// The fitness of every board indexed by Board::index(), once a FitnessTable
+/// is in use (see nqueens_table.h), else nullptr
+inline
+const std::uint8_t*& fitnessTable() {
+    static const std::uint8_t* table_s{nullptr};
+    return table_s;
+}
+
+/// The fitness function of the specimen.
+/// We have 8C2 = 28 possible attacking pairs
+/// The fittest specimen will have 0 attacking pairs
+inline
+unsigned score(const Board& b) {
+    if(const auto* table = fitnessTable()) {
+        return table[b.index()];
+    }
+    return scoreMemoizer()(b.index());
+}
+
+/// Optional Specimen hook that reports how often score() was served from
+/// its memoizing cache
+inline
+Memoizer::Stats scoreCacheStats(const Board&) {
+    return scoreMemoizer().stats_;
 }
 
 /// Given a crossing point, we create two children from two parents
 inline
 std::tuple<Board, Board> cross(const Board& first, const Board& second, uint8_t crossPoint) {
 
-    Board child1{first}, child2{second};
-    std::copy(std::begin(second.board_)+crossPoint, std::end(second.board_), std::begin(child1.board_)+crossPoint);
-    std::copy(std::begin(first.board_)+crossPoint, std::end(first.board_), std::begin(child2.board_)+crossPoint);
-
-    return {child1,child2};
+    //The columns before the crossing point are in the low bits
+    std::uint32_t head = (1u << (Board::bitsPerPos*crossPoint)) - 1;
+    return {Board::fromIndex((first.board_ & head) | (second.board_ & ~head)),
+            Board::fromIndex((second.board_ & head) | (first.board_ & ~head))};
 
 }
 
@@ -130,7 +196,7 @@ Board mutate(const Board& board) {
     //select a random point and mutate it
     Board mutated{board};
     unsigned col = distribution(randomEngine());
-    mutated.board_[col] = distribution(randomEngine());
+    mutated.set(col, distribution(randomEngine()));
     return mutated;
 }
 
@@ -0,0 +1,213 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <optional>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "nqueens.h"
+
+/**
+ * \ingroup Evolve
+ *
+ * The fitness of every possible 8x8 board, precomputed into a 16 MB table of
+ * bytes indexed by Board::index(). While a table is in use NQueens::score() is
+ * a single load from it, instead of counting the attacking pairs or looking up
+ * the memoizing cache
+ *
+ *     auto table = NQueens::FitnessTable::loadOrGenerate("nqueens.table");
+ *     table.use();
+ *
+ * A table is either generated in memory, which takes a fraction of a second
+ * spread over a few threads, or memory mapped from a file saved earlier. Linux
+ * only.
+ */
+
+namespace NQueens {
+
+class FitnessTable {
+public:
+    /// One entry for each of the 8^8 boards
+    static constexpr std::size_t size = std::size_t{1} << (3*Board::length);
+
+private:
+    struct alignas(64) Header {
+        char magic_[4];
+        std::uint32_t version_;
+        std::uint64_t size_;
+    };
+
+    static constexpr char magic[4] = {'E','V','Q','T'};
+    static constexpr std::uint32_t version = 1;
+
+    /// Owns the table when it was generated
+    std::vector<std::uint8_t> generated_;
+
+    /// Owns the table when it was loaded
+    void* mapping_{nullptr};
+    std::size_t mappedSize_{0};
+
+    const std::uint8_t* data_{nullptr};
+
+    FitnessTable() = default;
+
+    /// Place queens on the columns from col onwards, given the number of pairs
+    /// attacking each other among the queens already placed, and store the
+    /// fitness of each board that completes
+    static void fill(std::uint8_t* table, Board& board, std::size_t col, unsigned numAttackingPairs) {
+        if(col == Board::length) {
+            table[board.index()] = static_cast<std::uint8_t>(Board::maxFitness - numAttackingPairs);
+            return;
+        }
+        for(int row = 0; row < static_cast<int>(Board::length); row++) {
+            unsigned numAttacking{0};
+            for(std::size_t prev = 0; prev < col; prev++) {
+                int prevRow = board[prev];
+                if(prevRow == row || std::abs(row - prevRow) == static_cast<int>(col - prev)) {
+                    ++numAttacking;
+                }
+            }
+            board.set(col, row);
+            fill(table, board, col + 1, numAttackingPairs + numAttacking);
+        }
+    }
+
+    void unmap() {
+        if(mapping_) {
+            ::munmap(mapping_, mappedSize_);
+        }
+        mapping_ = nullptr;
+    }
+
+public:
+    /// Compute the table, splitting the boards by the row of their first queen
+    /// among upto numThreads threads
+    static FitnessTable generate(unsigned numThreads = std::thread::hardware_concurrency()) {
+        FitnessTable table;
+        table.generated_.resize(size);
+        table.data_ = table.generated_.data();
+
+        numThreads = std::clamp<unsigned>(numThreads, 1, Board::length);
+        auto work = [&table, numThreads](unsigned thread) {
+            Board board{{}};
+            for(unsigned row = thread; row < Board::length; row += numThreads) {
+                board.set(0, row);
+                fill(table.generated_.data(), board, 1, 0);
+            }
+        };
+        std::vector<std::thread> threads;
+        for(unsigned thread = 1; thread < numThreads; thread++) {
+            threads.emplace_back(work, thread);
+        }
+        work(0);
+        for(auto& thread : threads) {
+            thread.join();
+        }
+        return table;
+    }
+
+    /// Map the table saved at path read only, if there is a valid one there
+    static std::optional<FitnessTable> load(const std::string& path) {
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if(fd < 0) {
+            return std::nullopt;
+        }
+        struct stat st;
+        Header header{};
+        bool valid = ::fstat(fd, &st) == 0 && static_cast<std::size_t>(st.st_size) == sizeof(Header) + size
+                && ::pread(fd, &header, sizeof(header), 0) == sizeof(header)
+                && !std::memcmp(header.magic_, magic, sizeof(magic)) && header.version_ == version
+                && header.size_ == size;
+        std::optional<FitnessTable> table;
+        if(valid) {
+            void* mapping = ::mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+            if(mapping != MAP_FAILED) {
+                table.emplace(FitnessTable{});
+                table->mapping_ = mapping;
+                table->mappedSize_ = st.st_size;
+                table->data_ = static_cast<const std::uint8_t*>(mapping) + sizeof(Header);
+            }
+        }
+        ::close(fd);
+        return table;
+    }
+
+    /// Load the table saved at path, or generate it and save it there for
+    /// the next time
+    static FitnessTable loadOrGenerate(const std::string& path) {
+        if(auto table = load(path)) {
+            return std::move(*table);
+        }
+        auto table = generate();
+        table.save(path);
+        return table;
+    }
+
+    ~FitnessTable() {
+        if(data_ && fitnessTable() == data_) {
+            fitnessTable() = nullptr;
+        }
+        unmap();
+    }
+
+    FitnessTable(FitnessTable&& other) :
+        generated_{std::move(other.generated_)},
+        mapping_{std::exchange(other.mapping_, nullptr)},
+        mappedSize_{other.mappedSize_},
+        data_{std::exchange(other.data_, nullptr)}
+    {}
+
+    FitnessTable(const FitnessTable&) = delete;
+    FitnessTable& operator=(const FitnessTable&) = delete;
+    FitnessTable& operator=(FitnessTable&&) = delete;
+
+    /// Write the table to path, replacing what was there. The file is written
+    /// next to path and renamed over it, so readers never see half a table
+    bool save(const std::string& path) const {
+        std::string tmpPath{path + ".tmp"};
+        int fd = ::open(tmpPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if(fd < 0) {
+            return false;
+        }
+        Header header{};
+        std::memcpy(header.magic_, magic, sizeof(magic));
+        header.version_ = version;
+        header.size_ = size;
+        bool written = ::write(fd, &header, sizeof(header)) == sizeof(header);
+        for(std::size_t offset = 0; written && offset < size; ) {
+            auto count = ::write(fd, data_ + offset, size - offset);
+            written = count > 0;
+            offset += written ? count : 0;
+        }
+        ::close(fd);
+        if(!written || std::rename(tmpPath.c_str(), path.c_str()) != 0) {
+            std::remove(tmpPath.c_str());
+            return false;
+        }
+        return true;
+    }
+
+    /// Have NQueens::score() read from this table for as long as it lives
+    void use() const {
+        fitnessTable() = data_;
+    }
+
+    const std::uint8_t* data() const {
+        return data_;
+    }
+
+    unsigned operator[](const Board& board) const {
+        return data_[board.index()];
+    }
+};
+
+}
@@ -0,0 +1,152 @@
+#pragma once
+
+#include <algorithm>
+#include <numeric>
+#include <random>
+#include <tuple>
+#include <vector>
+#include "selection.h"
+#include "population.h"
+#include "specimen.h"
+
+/**
+ * \ingroup Evolve
+ *
+ * Compile time configuration of Evolve::Generation. A config is a struct that
+ * names a policy for each of the steps of a generation
+ *
+ *     struct MyConfig : Evolve::DefaultConfig {
+ *         using Selection = Evolve::TournamentSelection<3>;
+ *         using Replacement = Evolve::ElitistReplacement<2>;
+ *     };
+ *     Evolve::Generation<NQueens::Board, MyConfig> generation{boards};
+ *
+ * Selection picks parents (see selection.h), Mating writes two children from
+ * two parents into slots of the next generation, Replacement decides which
+ * specimens of the current generation survive into the next one and
+ * SolutionHandling decides what takes the place of a solved child. fuseScoring
+ * decides when children are scored and stopOnFirstSolution whether a solution
+ * cuts its generation short and collapseDuplicates whether identical specimens
+ * are scored once.
+ * Policies are held by value and called directly, so they are inlined and a
+ * config costs nothing at runtime.
+ */
+
+namespace Evolve {
+
+/// Mate using the mate() defined along with the Specimen, in place if the
+/// Specimen supports it (see InPlaceMatingSpecimen)
+struct MateBySpecimen {
+    template<typename Specimen, typename Rng>
+    void operator()(const Specimen& first, const Specimen& second, Specimen& child1, Specimen& child2, Rng&) const {
+        if constexpr (InPlaceMatingSpecimen<Specimen>) {
+            mate(first, second, child1, child2);
+        } else {
+            std::tie(child1, child2) = mate(first, second);
+        }
+    }
+};
+
+/// Cross over at NumCrossovers random points and then mutate each child
+/// NumMutations times, using the cross() and mutate() defined along with the
+/// Specimen. Crossing points are in [0, Specimen::length]
+template<size_t NumCrossovers, size_t NumMutations = 1>
+struct CrossAndMutate {
+    template<typename Specimen, typename Rng>
+    void operator()(const Specimen& first, const Specimen& second, Specimen& child1, Specimen& child2, Rng& rng) const {
+        std::uniform_int_distribution<size_t> distribution(0, Specimen::length);
+        child1 = first;
+        child2 = second;
+        //Crossing the children again at another point swaps back their tails,
+        //so successive crosses make a multi point crossover
+        for(size_t i = 0; i < NumCrossovers; i++) {
+            std::tie(child1, child2) = cross(child1, child2, distribution(rng));
+        }
+        for(size_t i = 0; i < NumMutations; i++) {
+            child1 = mutate(child1);
+            child2 = mutate(child2);
+        }
+    }
+};
+
+/// Replacement policies overwrite the first numKept specimens of the next
+/// generation with the specimens they keep. Every specimen is replaced by an
+/// offspring here
+struct GenerationalReplacement {
+    static constexpr size_t numKept = 0;
+
+    template<typename Specimen>
+    void operator()(const Population<Specimen>&, Population<Specimen>&) {
+    }
+};
+
+/// The NumElites fittest specimens are carried over unchanged and the rest are
+/// replaced by offsprings
+template<size_t NumElites>
+class ElitistReplacement {
+    /// Indices of the specimens, used to find the elites
+    std::vector<size_t> byFitness_;
+
+public:
+    static constexpr size_t numKept = NumElites;
+
+    template<typename Specimen>
+    void operator()(const Population<Specimen>& specimens, Population<Specimen>& next) {
+        auto fitnessScores = specimens.fitness();
+        auto numElites = std::min(NumElites, specimens.size());
+        byFitness_.resize(specimens.size());
+        std::iota(std::begin(byFitness_), std::end(byFitness_), 0);
+        std::partial_sort(std::begin(byFitness_), std::begin(byFitness_) + numElites, std::end(byFitness_),
+                          [&](size_t lhs, size_t rhs) {
+            return fitnessScores[lhs] > fitnessScores[rhs];
+        });
+        for(size_t i = 0; i < numElites; i++) {
+            next[i] = specimens[byFitness_[i]];
+        }
+    }
+};
+
+/// A solved child leaves the population and a random specimen takes its place
+struct ReplaceSolvedWithRandom {
+    template<typename Specimen>
+    Specimen operator()(const Specimen&) const {
+        return Specimen::random();
+    }
+};
+
+/// A solved child stays in the population
+struct KeepSolved {
+    template<typename Specimen>
+    Specimen operator()(const Specimen& solution) const {
+        return solution;
+    }
+};
+
+/// The behaviour of Generation before configs were introduced
+struct DefaultConfig {
+    using Selection = FitnessProportionalSelection;
+    using Mating = MateBySpecimen;
+    using Replacement = GenerationalReplacement;
+    using SolutionHandling = ReplaceSolvedWithRandom;
+
+    /// Score each child right after it is mated, while it is still in cache,
+    /// instead of scoring the whole generation in another pass over it. Always
+    /// the case for specimens that declare their max fitness (see
+    /// DeclaredMaxFitnessSpecimen)
+    static constexpr bool fuseScoring = false;
+
+    /// Cancel evolution as soon as a solution is found, instead of completing
+    /// the generation it was found in (see Generation::cancel() and
+    /// Generation::resetCancellation())
+    static constexpr bool stopOnFirstSolution = false;
+
+    /// Score each distinct specimen of a generation once and copy its score to
+    /// its duplicates, which are found by fingerprint (see SpecimenFingerprint).
+    /// Pays off when scoring costs more than fingerprinting and selection makes
+    /// many identical children. Children scored as they are mated are not
+    /// collapsed, so for specimens that declare their max fitness it only
+    /// applies to the first generation and to those cut short
+    static constexpr bool collapseDuplicates = false;
+};
+
+}
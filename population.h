@@ -0,0 +1,133 @@
+#pragma once
+
+#include <cstddef>
+#include <iterator>
+#include <new>
+#include <span>
+#include <utility>
+#include <vector>
+
+/**
+ * \ingroup Evolve
+ *
+ * Storage for the specimens of a generation. The genomes are kept contiguous
+ * in one buffer and their fitness scores in a parallel buffer, both starting on
+ * a cache line so that SIMD loads over the genomes and the scores are aligned. The buffers are reused from one generation to
+ * the next, so a population stops allocating once it has reached its size.
+ */
+
+namespace Evolve {
+
+/// Allocates buffers aligned to Alignment bytes
+template<typename T, std::size_t Alignment>
+struct AlignedAllocator {
+    using value_type = T;
+
+    template<typename U>
+    struct rebind {
+        using other = AlignedAllocator<U, Alignment>;
+    };
+
+    AlignedAllocator() = default;
+
+    template<typename U>
+    AlignedAllocator(const AlignedAllocator<U, Alignment>&) {
+    }
+
+    T* allocate(std::size_t n) {
+        return static_cast<T*>(::operator new(n*sizeof(T), std::align_val_t{Alignment}));
+    }
+
+    void deallocate(T* ptr, std::size_t) {
+        ::operator delete(ptr, std::align_val_t{Alignment});
+    }
+
+    bool operator==(const AlignedAllocator&) const = default;
+};
+
+template<typename Specimen>
+class Population {
+public:
+    static constexpr std::size_t alignment = 64;
+
+    template<typename T>
+    using Buffer = std::vector<T, AlignedAllocator<T, alignment>>;
+
+private:
+    Buffer<Specimen> specimens_;
+
+    /// fitness_[i] is the fitness of specimens_[i], once it has been scored
+    Buffer<unsigned> fitness_;
+
+public:
+    Population() = default;
+
+    template<typename Iterator>
+    Population(Iterator begin, Iterator end) : specimens_(begin, end)
+    {}
+
+    std::size_t size() const {
+        return specimens_.size();
+    }
+
+    bool empty() const {
+        return specimens_.empty();
+    }
+
+    void reserve(std::size_t n) {
+        specimens_.reserve(n);
+        fitness_.reserve(n);
+    }
+
+    Specimen& operator[](std::size_t idx) {
+        return specimens_[idx];
+    }
+
+    const Specimen& operator[](std::size_t idx) const {
+        return specimens_[idx];
+    }
+
+    const Specimen* data() const {
+        return specimens_.data();
+    }
+
+    auto begin() const {
+        return specimens_.begin();
+    }
+
+    auto end() const {
+        return specimens_.end();
+    }
+
+    template<typename... Args>
+    Specimen& emplace_back(Args&&... args) {
+        return specimens_.emplace_back(std::forward<Args>(args)...);
+    }
+
+    /// Make room for the fitness of every specimen
+    std::span<unsigned> resizeFitness() {
+        fitness_.resize(specimens_.size());
+        return fitness();
+    }
+
+    std::span<unsigned> fitness() {
+        return fitness_;
+    }
+
+    std::span<const unsigned> fitness() const {
+        return fitness_;
+    }
+
+    /// Keeps the capacity of both buffers
+    void clear() {
+        specimens_.clear();
+        fitness_.clear();
+    }
+
+    void swap(Population& other) {
+        specimens_.swap(other.specimens_);
+        fitness_.swap(other.fitness_);
+    }
+};
+
+}
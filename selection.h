@@ -0,0 +1,149 @@
+#pragma once
+
+#include <algorithm>
+#include <numeric>
+#include <random>
+#include <span>
+#include <vector>
+
+/**
+ * \ingroup Evolve
+ *
+ * Selection policies for Evolve::Generation. A generation picks every parent
+ * through its selection policy, which is a template parameter so that there is
+ * no virtual dispatch on the hot path. A policy provides
+ *
+ *     void prepare(std::span<const unsigned> fitnessScores);
+ *     template<typename Rng> size_t operator()(Rng& rng);
+ *
+ * prepare() is called once per generation with the fitness score of every specimen
+ * and operator() then returns the index of a selected specimen. Policies keep their
+ * buffers from one generation to the next, so they do not allocate once warmed up.
+ */
+
+namespace Evolve {
+
+namespace detail {
+
+/// Like std::discrete_distribution, except that the weights are kept in a buffer
+/// that is reused when the weights change, instead of being reallocated
+class WeightedIndex {
+    std::vector<double> cumulative_;
+
+public:
+    template<typename Iterator>
+    void assign(Iterator begin, Iterator end) {
+        cumulative_.clear();
+        double sum{0};
+        for(; begin != end; ++begin) {
+            sum += *begin;
+            cumulative_.push_back(sum);
+        }
+    }
+
+    template<typename Rng>
+    size_t operator()(Rng& rng) const {
+        //All zero weights are treated as equal weights
+        if(cumulative_.back() == 0) {
+            return std::uniform_int_distribution<size_t>(0, cumulative_.size() - 1)(rng);
+        }
+        double r = std::uniform_real_distribution<double>(0, cumulative_.back())(rng);
+        auto itr = std::upper_bound(std::begin(cumulative_), std::end(cumulative_), r);
+        return std::min<size_t>(itr - std::begin(cumulative_), cumulative_.size() - 1);
+    }
+};
+
+}
+
+/// The likelihood of selecting a specimen is proportional to its fitness
+class FitnessProportionalSelection {
+    detail::WeightedIndex distribution_;
+
+public:
+    void prepare(std::span<const unsigned> fitnessScores) {
+        distribution_.assign(std::begin(fitnessScores), std::end(fitnessScores));
+    }
+
+    template<typename Rng>
+    size_t operator()(Rng& rng) {
+        return distribution_(rng);
+    }
+};
+
+/// Pick K specimens at random and select the fittest of them. Larger K means
+/// stronger selection pressure
+template<size_t K>
+class TournamentSelection {
+    static_assert(K >= 1, "A tournament needs atleast one specimen");
+    std::span<const unsigned> fitnessScores_;
+
+public:
+    void prepare(std::span<const unsigned> fitnessScores) {
+        fitnessScores_ = fitnessScores;
+    }
+
+    template<typename Rng>
+    size_t operator()(Rng& rng) {
+        std::uniform_int_distribution<size_t> distribution(0, fitnessScores_.size() - 1);
+        size_t best = distribution(rng);
+        for(size_t i = 1; i < K; i++) {
+            size_t contender = distribution(rng);
+            if(fitnessScores_[contender] > fitnessScores_[best]) {
+                best = contender;
+            }
+        }
+        return best;
+    }
+};
+
+/// The likelihood of selecting a specimen is proportional to its rank, the least
+/// fit specimen having rank 1. Unlike fitness proportional selection, this does
+/// not depend on how far apart the scores are
+class RankSelection {
+    std::vector<size_t> byFitness_;
+    std::vector<size_t> weights_;
+    detail::WeightedIndex distribution_;
+
+public:
+    void prepare(std::span<const unsigned> fitnessScores) {
+        byFitness_.resize(fitnessScores.size());
+        std::iota(std::begin(byFitness_), std::end(byFitness_), 0);
+        std::sort(std::begin(byFitness_), std::end(byFitness_), [&](size_t lhs, size_t rhs) {
+            return fitnessScores[lhs] < fitnessScores[rhs];
+        });
+        weights_.resize(fitnessScores.size());
+        std::iota(std::begin(weights_), std::end(weights_), 1);
+        distribution_.assign(std::begin(weights_), std::end(weights_));
+    }
+
+    template<typename Rng>
+    size_t operator()(Rng& rng) {
+        return byFitness_[distribution_(rng)];
+    }
+};
+
+/// Select uniformly among the fittest Percent percent of the specimens
+template<size_t Percent>
+class TruncationSelection {
+    static_assert(Percent > 0 && Percent <= 100, "Percent must be in (0,100]");
+    std::vector<size_t> byFitness_;
+    size_t numSelectable_{0};
+
+public:
+    void prepare(std::span<const unsigned> fitnessScores) {
+        byFitness_.resize(fitnessScores.size());
+        std::iota(std::begin(byFitness_), std::end(byFitness_), 0);
+        numSelectable_ = std::max<size_t>(1, fitnessScores.size()*Percent/100);
+        std::nth_element(std::begin(byFitness_), std::begin(byFitness_) + numSelectable_ - 1, std::end(byFitness_),
+                         [&](size_t lhs, size_t rhs) {
+            return fitnessScores[lhs] > fitnessScores[rhs];
+        });
+    }
+
+    template<typename Rng>
+    size_t operator()(Rng& rng) {
+        return byFitness_[std::uniform_int_distribution<size_t>(0, numSelectable_ - 1)(rng)];
+    }
+};
+
+}
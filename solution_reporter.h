@@ -0,0 +1,77 @@
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+/**
+ * \ingroup Evolve
+ *
+ * Delivers solutions found by Evolve::Generation to a callback that runs on a
+ * separate reporter thread, so that printing or logging a solution never stalls
+ * evolution. Use it as the solution callback of a Generation:
+ *
+ *     Evolve::SolutionReporter<Specimen> reporter{[](const Specimen& s) { std::cout << s; }};
+ *     generation.setSolutionCallback(std::ref(reporter));
+ *
+ * Solutions still queued when the reporter is destroyed are delivered before
+ * its destructor returns.
+ */
+
+namespace Evolve {
+
+template<typename Specimen>
+class SolutionReporter {
+    std::function<void(const Specimen&)> callback_;
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::deque<Specimen> queue_;
+    bool stopping_{false};
+    std::thread thread_;
+
+    void run() {
+        std::unique_lock<std::mutex> lock{mutex_};
+        while(true) {
+            cv_.wait(lock, [this]() { return stopping_ || !queue_.empty(); });
+            if(queue_.empty()) {
+                return;
+            }
+            Specimen solution{std::move(queue_.front())};
+            queue_.pop_front();
+            lock.unlock();
+            callback_(solution);
+            lock.lock();
+        }
+    }
+
+public:
+    explicit SolutionReporter(std::function<void(const Specimen&)> callback) :
+        callback_{std::move(callback)},
+        thread_{[this]() { run(); }}
+    {}
+
+    ~SolutionReporter() {
+        {
+            std::lock_guard<std::mutex> lock{mutex_};
+            stopping_ = true;
+        }
+        cv_.notify_one();
+        thread_.join();
+    }
+
+    SolutionReporter(const SolutionReporter&) = delete;
+    SolutionReporter& operator=(const SolutionReporter&) = delete;
+
+    /// Queue a solution. Only holds the lock long enough to copy it
+    void operator()(const Specimen& solution) {
+        {
+            std::lock_guard<std::mutex> lock{mutex_};
+            queue_.push_back(solution);
+        }
+        cv_.notify_one();
+    }
+};
+
+}
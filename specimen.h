@@ -0,0 +1,91 @@
+#pragma once
+
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <tuple>
+#include <type_traits>
+#include "memoizer.h"
+
+/**
+ * \ingroup Evolve
+ *
+ * Concepts describing what Evolve::Generation expects from a Specimen type.
+ * The operations are found via ADL, so they are declared along with the
+ * Specimen in its own namespace.
+ *
+ * EvolvableSpecimen is what every Specimen provides. The other concepts are
+ * optional hooks, and the engine switches to a faster path when a Specimen
+ * satisfies one of them.
+ */
+
+namespace Evolve {
+
+/// score() returns the fitness of a specimen, higher being fitter. mate()
+/// creates two children from two parents, solved() tells if a specimen solves
+/// the problem and random() creates a specimen for the first generation
+template<typename Specimen>
+concept EvolvableSpecimen = std::copy_constructible<Specimen> && requires(const Specimen& specimen) {
+    { score(specimen) } -> std::convertible_to<unsigned>;
+    { mate(specimen, specimen) } -> std::convertible_to<std::tuple<Specimen, Specimen>>;
+    { solved(specimen) } -> std::convertible_to<bool>;
+    { Specimen::random() } -> std::convertible_to<Specimen>;
+};
+
+/// Specimens that already know their fitness (e.g. because mating computed it as
+/// a side effect) return it from cachedScore()
+template<typename Specimen>
+concept CachedScoreSpecimen = requires(const Specimen& specimen) {
+    { cachedScore(specimen) } -> std::same_as<std::optional<unsigned>>;
+};
+
+/// scoreCacheStats() returns the cumulative hits_ and misses_ of the cache
+/// behind score()
+template<typename Specimen>
+concept ScoreCacheStatsSpecimen = requires(const Specimen& specimen) {
+    { scoreCacheStats(specimen) } -> std::convertible_to<Memoizer::Stats>;
+};
+
+/// Specimens whose fitness is Specimen::maxFitness when, and only when, they
+/// solve the problem. Solutions are then found from the score, which is often
+/// already known, instead of calling solved(), and children keep the score
+/// they were checked with as if scoring was fused (see DefaultConfig::fuseScoring)
+template<typename Specimen>
+concept DeclaredMaxFitnessSpecimen = requires {
+    { Specimen::maxFitness } -> std::convertible_to<unsigned>;
+};
+
+/// mate(first, second, child1, child2) writes the two children into existing
+/// specimens, so that they can be created in place in the next generation
+template<typename Specimen>
+concept InPlaceMatingSpecimen = requires(const Specimen& parent, Specimen& child) {
+    mate(parent, parent, child, child);
+};
+
+/// fingerprint() returns a 64 bit hash of the genome, the same for equal genomes.
+/// Specimens can keep it up to date as they change (e.g. Zobrist hashing), so that
+/// hash based caches and deduplication do not rehash the whole genome
+template<typename Specimen>
+concept FingerprintSpecimen = requires(const Specimen& specimen) {
+    { fingerprint(specimen) } -> std::convertible_to<std::uint64_t>;
+};
+
+/// Hashes specimens using fingerprint() if they have one, or else their bytes
+template<typename Specimen>
+struct SpecimenFingerprint {
+    std::uint64_t operator()(const Specimen& specimen) const {
+        if constexpr (FingerprintSpecimen<Specimen>) {
+            return fingerprint(specimen);
+        } else {
+            return Memoizer::BytesFingerprint<Specimen>{}(specimen);
+        }
+    }
+};
+
+/// Specimens that can be copied as raw bytes, e.g. to write them out or to
+/// store them in untyped buffers
+template<typename Specimen>
+concept TriviallyCopyableSpecimen = std::is_trivially_copyable_v<Specimen>;
+
+}
@@ -0,0 +1,91 @@
+#pragma once
+
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <optional>
+#include "instrument.h"
+
+/**
+ * \ingroup Evolve
+ *
+ * Per generation statistics of Evolve::Generation. They are computed while the
+ * generation is scored and handed to a sink after every generation by
+ * Evolve::evolve(). A sink is any callable taking a const GenerationStats&.
+ */
+
+namespace Evolve {
+
+struct GenerationStats {
+    /// Number of generations evolved so far, including this one
+    unsigned generation_{0};
+
+    unsigned minFitness_{0};
+    unsigned maxFitness_{0};
+    double meanFitness_{0};
+
+    /// Standard deviation of the fitness scores. It drops towards 0 as the
+    /// population converges
+    double diversity_{0};
+
+    /// Fraction of score() calls served by the specimen's memoizing cache. Only
+    /// known if the Specimen type provides the scoreCacheStats() hook and scored
+    /// atleast one specimen through score()
+    std::optional<double> cacheHitRate_;
+
+    /// Fraction of the specimens that were duplicates of another specimen of
+    /// the generation, and so were not scored. Only known when duplicates are
+    /// collapsed (see DefaultConfig::collapseDuplicates)
+    std::optional<double> duplicateRatio_;
+
+    /// Time taken by this generation and since the Generation was created
+    std::chrono::nanoseconds duration_{0};
+    std::chrono::nanoseconds elapsed_{0};
+
+    /// Only recorded if EVOLVE_INSTRUMENT is defined
+    PhaseStats phases_;
+};
+
+namespace detail {
+
+/// Accumulates fitness scores one at a time
+struct FitnessAccumulator {
+    unsigned min_{~0u};
+    unsigned max_{0};
+    double sum_{0};
+    double sumSq_{0};
+    size_t count_{0};
+
+    void add(unsigned fitness) {
+        min_ = std::min(min_, fitness);
+        max_ = std::max(max_, fitness);
+        sum_ += fitness;
+        sumSq_ += double(fitness)*fitness;
+        ++count_;
+    }
+
+    void fill(GenerationStats& stats) const {
+        stats.minFitness_ = count_ ? min_ : 0;
+        stats.maxFitness_ = max_;
+        stats.meanFitness_ = count_ ? sum_/count_ : 0;
+        stats.diversity_ = count_ ? std::sqrt(std::max(0.0, sumSq_/count_ - stats.meanFitness_*stats.meanFitness_)) : 0;
+    }
+};
+
+}
+
+/// The default sink, which prints the progress every interval_ generations
+struct PrintProgress {
+    unsigned interval_{1000};
+
+    void operator()(const GenerationStats& stats) const {
+        if(stats.generation_ % interval_ == 0) {
+            std::cout << "Generation : " << stats.generation_ << ", maxScore = " << stats.maxFitness_ << std::endl;
+            if constexpr (instrumented) {
+                std::cout << "Phases : " << stats.phases_ << std::endl;
+            }
+        }
+    }
+};
+
+}
@@ -4,8 +4,14 @@
 #include <catch2/catch.hpp>
 #include "evolve.h"
 #include "nqueens.h"
+#include "nqueens_table.h"
+#include "knights_tour.h"
+#include "tiled_tour.h"
+#include "solution_reporter.h"
 #include "memoizer.h"
+#include "mapped_cache.h"
 #include <iostream>
+#include <fstream>
 
 class MySpecimen {
 public:
@@ -29,13 +35,34 @@ TEST_CASE("generationConstructionTest", "[evolve]") {
     REQUIRE(!generation.hasSolutions());
 }
 
+TEST_CASE("specimen concepts", "[evolve]") {
+
+    static_assert(!Evolve::EvolvableSpecimen<MySpecimen>);
+    static_assert(Evolve::EvolvableSpecimen<NQueens::Board>);
+    static_assert(Evolve::EvolvableSpecimen<KnightsTour::Tour>);
+
+    static_assert(Evolve::CachedScoreSpecimen<KnightsTour::Tour>);
+    static_assert(!Evolve::CachedScoreSpecimen<NQueens::Board>);
+    static_assert(Evolve::ScoreCacheStatsSpecimen<NQueens::Board>);
+    static_assert(Evolve::TriviallyCopyableSpecimen<KnightsTour::Tour>);
+    static_assert(Evolve::DeclaredMaxFitnessSpecimen<KnightsTour::Tour>);
+    static_assert(Evolve::DeclaredMaxFitnessSpecimen<NQueens::Board>);
+    static_assert(!Evolve::DeclaredMaxFitnessSpecimen<MySpecimen>);
+    static_assert(Evolve::FingerprintSpecimen<KnightsTour::Tour>);
+    static_assert(!Evolve::FingerprintSpecimen<NQueens::Board>);
+}
+
 TEST_CASE("nqueens") {
     std::array<std::uint8_t, 8> defaultArray = {};
     NQueens::Board boarda{defaultArray}, boardb{defaultArray}, boardc{defaultArray};
-    for(uint8_t idx = 0; idx < boarda.board_.size(); idx++) {
-        boarda.board_[idx] = idx;
-        boardb.board_[idx] = idx+1;
-        boardc.board_[idx] = idx;
+    for(uint8_t idx = 0; idx < NQueens::Board::length; idx++) {
+        boarda.set(idx, 7 - idx);
+        boardb.set(idx, idx);
+        boardc.set(idx, 7 - idx);
+    }
+    for(uint8_t idx = 0; idx < NQueens::Board::length; idx++) {
+        REQUIRE(boarda[idx] == 7u - idx);
+        REQUIRE(boardb[idx] == idx);
     }
 
     REQUIRE(boarda < boardb);
@@ -43,6 +70,64 @@ TEST_CASE("nqueens") {
 
     REQUIRE_FALSE(boarda < boardc);
     REQUIRE_FALSE(boardc < boarda);
+    REQUIRE(boarda == boardc);
+    REQUIRE(NQueens::Board::fromIndex(boardb.index()) == boardb);
+
+    /// Crossing swaps the columns from the crossing point on
+    for(uint8_t crossPoint = 0; crossPoint <= NQueens::Board::length; crossPoint++) {
+        auto [child1, child2] = NQueens::cross(boarda, boardb, crossPoint);
+        for(uint8_t idx = 0; idx < NQueens::Board::length; idx++) {
+            REQUIRE(child1[idx] == (idx < crossPoint ? boarda : boardb)[idx]);
+            REQUIRE(child2[idx] == (idx < crossPoint ? boardb : boarda)[idx]);
+        }
+    }
+
+    /// A mutation changes atmost one column
+    for(int i = 0; i < 100; i++) {
+        auto mutated = NQueens::mutate(boarda);
+        int numChanged{0};
+        for(uint8_t idx = 0; idx < NQueens::Board::length; idx++) {
+            numChanged += mutated[idx] != boarda[idx];
+        }
+        REQUIRE(numChanged <= 1);
+    }
+}
+
+TEST_CASE("nqueens fitness table") {
+    auto table = NQueens::FitnessTable::generate(3);
+    for(int i = 0; i < 1000; i++) {
+        auto board = NQueens::Board::random();
+        REQUIRE(table[board] == 28 - board.numAttackingPairs());
+    }
+    NQueens::Board solution{{0, 4, 7, 5, 2, 6, 1, 3}};
+    REQUIRE(table[solution] == NQueens::Board::maxFitness);
+
+    /// score() reads from the table while it is in use, instead of the cache
+    auto board = NQueens::Board::random();
+    auto lookups = [&]() {
+        auto stats = NQueens::scoreCacheStats(board);
+        return stats.hits_ + stats.misses_;
+    };
+    auto numLookups = lookups();
+    {
+        auto other = NQueens::FitnessTable::generate(1);
+        other.use();
+        REQUIRE(NQueens::fitnessTable() == other.data());
+        REQUIRE(NQueens::score(board) == 28 - board.numAttackingPairs());
+        REQUIRE(lookups() == numLookups);
+    }
+    REQUIRE(NQueens::fitnessTable() == nullptr);
+
+    /// A saved table maps back identically
+    std::string path{"evolve_test.table"};
+    REQUIRE(table.save(path));
+    {
+        auto loaded = NQueens::FitnessTable::load(path);
+        REQUIRE(loaded);
+        REQUIRE(!std::memcmp(loaded->data(), table.data(), NQueens::FitnessTable::size));
+    }
+    std::remove(path.c_str());
+    REQUIRE_FALSE(NQueens::FitnessTable::load(path));
 }
 
 TEST_CASE("memoizer") {
@@ -64,3 +149,803 @@ TEST_CASE("memoizer") {
     REQUIRE(global == 1);
 }
 
+
+TEST_CASE("knightstour cached score") {
+
+    KnightsTour::Tour first{KnightsTour::Tour::random()}, second{KnightsTour::Tour::random()};
+    REQUIRE_FALSE(KnightsTour::cachedScore(first));
+
+    KnightsTour::Tour child1{first}, child2{second};
+    std::tie(child1, child2) = KnightsTour::mate(first, second);
+    for(const auto& child : {child1, child2}) {
+        REQUIRE(KnightsTour::cachedScore(child));
+        REQUIRE(*KnightsTour::cachedScore(child) == child.numValidSteps());
+    }
+
+    auto mutated = KnightsTour::mutate(child1);
+    REQUIRE_FALSE(KnightsTour::cachedScore(mutated));
+}
+
+TEST_CASE("tiled knights tour") {
+
+    REQUIRE(TiledTour::splitDimension(8) == std::vector<int>{8});
+    REQUIRE(TiledTour::splitDimension(19) == std::vector<int>{8,6,5});
+    REQUIRE(TiledTour::splitDimension(25) == std::vector<int>{8,8,9});
+
+    for(auto dims : {std::make_tuple(5,5), std::make_tuple(8,8), std::make_tuple(24,30),
+                     std::make_tuple(27,31), std::make_tuple(100,100)}) {
+        auto tour = TiledTour::solve(std::get<0>(dims), std::get<1>(dims), 42, 4);
+        REQUIRE(tour);
+        REQUIRE(TiledTour::isValid(*tour));
+    }
+
+    REQUIRE_FALSE(TiledTour::solve(4, 8, 42));
+}
+
+TEST_CASE("knightstour move targets") {
+    using KnightsTour::Tour;
+
+    static_assert(Tour::moveTargets[0][KnightsTour::movIndex({1,2})] == 10);
+    static_assert(Tour::moveTargets[0][KnightsTour::movIndex({-1,2})] == KnightsTour::noSquare);
+    static_assert(Tour::moveTargets[63][KnightsTour::movIndex({-2,-1})] == 46);
+
+    for(unsigned sq = 0; sq < Tour::numSquares; sq++) {
+        unsigned idx{0};
+        for(const auto& mov : KnightsTour::moves) {
+            REQUIRE(KnightsTour::movIndex(mov) == idx);
+            int row = sq/Tour::numCols + mov.rdelta_, col = sq%Tour::numCols + mov.cdelta_;
+            bool onBoard = row >= 0 && row < Tour::numRows && col >= 0 && col < Tour::numCols;
+            REQUIRE(Tour::moveTargets[sq][idx] == (onBoard ? row*Tour::numCols + col : KnightsTour::noSquare));
+            idx++;
+        }
+    }
+}
+
+TEST_CASE("knightstour repair") {
+
+    REQUIRE_FALSE(KnightsTour::RepairOptions{}.enabled());
+
+    randomEngine().seed(5);
+    std::vector<KnightsTour::Tour> tours;
+    std::generate_n(std::back_inserter(tours), 20, KnightsTour::Tour::random);
+
+    std::vector<unsigned> unrepaired;
+    for(const auto& tour : tours) {
+        unrepaired.push_back(KnightsTour::extend(tour).numValidSteps());
+    }
+
+    for(size_t i = 0; i < tours.size(); i++) {
+        auto repaired = KnightsTour::extend(tours[i], {8, 1000});
+        REQUIRE(*KnightsTour::cachedScore(repaired) == repaired.numValidSteps());
+        REQUIRE(repaired.numValidSteps() >= unrepaired[i]);
+    }
+
+    /// With an unbounded depth and enough budget, the search finds a full tour
+    KnightsTour::RepairOptions unbounded{KnightsTour::Tour::length, 1000000};
+    REQUIRE(KnightsTour::extend(tours.front(), unbounded).solved());
+
+    /// Generations repair as per their own mating policy
+    struct RepairConfig : Evolve::DefaultConfig {
+        using Mating = KnightsTour::MateWithRepair;
+    };
+    Evolve::Generation<KnightsTour::Tour, RepairConfig> repairing{std::vector<KnightsTour::Tour>(tours)};
+    Evolve::Generation<KnightsTour::Tour, RepairConfig> plain{std::vector<KnightsTour::Tour>(tours)};
+    repairing.mating().options_ = unbounded;
+    REQUIRE_FALSE(plain.mating().options_.enabled());
+    KnightsTour::Tour child1{tours[0]}, child2{tours[0]};
+    std::default_random_engine rng;
+    repairing.mating()(tours[0], tours[1], child1, child2, rng);
+    REQUIRE(child1.solved());
+    REQUIRE(child2.solved());
+}
+
+TEST_CASE("phase stats") {
+
+    std::vector<NQueens::Board> boards;
+    std::generate_n(std::back_inserter(boards), 20, NQueens::Board::random);
+    Evolve::Generation<NQueens::Board> generation{std::move(boards)};
+    generation.circleOfLife();
+
+    const auto& stats = generation.phaseStats();
+    if constexpr (Evolve::instrumented) {
+        REQUIRE(stats.ns(Evolve::Phase::offspring) > 0);
+        /// The population buffers are reserved up front, but the memoizer
+        /// allocates for every new tour it scores
+        REQUIRE(stats.allocations(Evolve::Phase::score) > 0);
+    } else {
+        REQUIRE(stats.ns(Evolve::Phase::offspring) == 0);
+        REQUIRE(stats.allocations(Evolve::Phase::score) == 0);
+    }
+}
+
+TEST_CASE("generation stats") {
+
+    std::vector<NQueens::Board> boards;
+    std::generate_n(std::back_inserter(boards), 50, NQueens::Board::random);
+    std::vector<unsigned> scores;
+    std::transform(std::begin(boards), std::end(boards), std::back_inserter(scores),
+                   [](const auto& board) { return NQueens::score(board); });
+
+    Evolve::Generation<NQueens::Board> generation{std::move(boards)};
+    generation.circleOfLife();
+
+    const auto& stats = generation.stats();
+    REQUIRE(stats.generation_ == 1);
+    REQUIRE(stats.minFitness_ == *std::min_element(std::begin(scores), std::end(scores)));
+    REQUIRE(stats.maxFitness_ == *std::max_element(std::begin(scores), std::end(scores)));
+    REQUIRE(generation.maxScore() == stats.maxFitness_);
+    REQUIRE(stats.meanFitness_ == Approx(std::accumulate(std::begin(scores), std::end(scores), 0.0)/scores.size()));
+    /// Every board was scored above, so they are all served from the cache
+    REQUIRE(stats.cacheHitRate_);
+    REQUIRE(*stats.cacheHitRate_ == Approx(1.0));
+
+    unsigned numCalls{0};
+    auto numGenerations = Evolve::evolve(generation, 3, [&](const Evolve::GenerationStats& s) {
+        REQUIRE(s.generation_ == 1 + ++numCalls);
+    });
+    REQUIRE(numCalls == numGenerations);
+}
+
+TEST_CASE("cache hit rate") {
+
+    /// Boards declare their max fitness, so children are scored once, as they
+    /// are mated, and the hit rate reported with the next generation counts
+    /// those lookups
+    randomEngine().seed(11);
+    std::vector<NQueens::Board> boards;
+    std::generate_n(std::back_inserter(boards), 50, NQueens::Board::random);
+    Evolve::Generation<NQueens::Board> generation{std::move(boards)};
+    unsigned numSolutions{0};
+    generation.setSolutionCallback([&](const NQueens::Board&) {
+        ++numSolutions;
+    });
+
+    std::vector<Memoizer::Stats> cacheStats{NQueens::scoreCacheStats(generation.population()[0])};
+    std::vector<unsigned> solutionCounts{0};
+    for(int i = 0; i < 6; i++) {
+        generation.circleOfLife();
+        cacheStats.push_back(NQueens::scoreCacheStats(generation.population()[0]));
+        solutionCounts.push_back(numSolutions);
+        if(i < 2) {
+            continue;
+        }
+        /// Lookups made while mating the generation before
+        auto hits = cacheStats[i].hits_ - cacheStats[i-1].hits_;
+        auto misses = cacheStats[i].misses_ - cacheStats[i-1].misses_;
+        /// Solved children are replaced by a random board, which is scored too
+        REQUIRE(hits + misses == generation.size() + solutionCounts[i] - solutionCounts[i-1]);
+        REQUIRE(misses > 0);
+        const auto& stats = generation.stats();
+        REQUIRE(stats.cacheHitRate_);
+        REQUIRE(*stats.cacheHitRate_ == Approx(double(hits)/(hits + misses)));
+    }
+}
+
+TEST_CASE("solution reporter") {
+
+    std::vector<int> reported;
+    std::thread::id reporterThread;
+    {
+        Evolve::SolutionReporter<int> reporter{[&](const int& solution) {
+            reporterThread = std::this_thread::get_id();
+            reported.push_back(solution);
+        }};
+        for(int i = 0; i < 100; i++) {
+            reporter(i);
+        }
+    }
+
+    REQUIRE(reported.size() == 100);
+    REQUIRE(std::is_sorted(std::begin(reported), std::end(reported)));
+    REQUIRE(reporterThread != std::this_thread::get_id());
+}
+
+template<typename S, size_t NumElites, typename M = Evolve::MateBySpecimen>
+struct TestConfig : Evolve::DefaultConfig {
+    using Selection = S;
+    using Mating = M;
+    using Replacement = Evolve::ElitistReplacement<NumElites>;
+};
+
+template<typename Selection, size_t NumElites, typename Mating = Evolve::MateBySpecimen>
+void checkSelection(size_t populationSize) {
+    randomEngine().seed(7);
+    std::vector<NQueens::Board> boards;
+    std::generate_n(std::back_inserter(boards), populationSize, NQueens::Board::random);
+    Evolve::Generation<NQueens::Board, TestConfig<Selection, NumElites, Mating>> generation{std::move(boards)};
+
+    unsigned maxScore{0};
+    for(int i = 0; i < 20 && !generation.hasSolutions(); i++) {
+        generation.circleOfLife();
+        REQUIRE(generation.size() == populationSize);
+        if(NumElites) {
+            /// The fittest specimen is carried over, so the best score never drops
+            REQUIRE(generation.maxScore() >= maxScore);
+        }
+        maxScore = generation.maxScore();
+    }
+}
+
+TEST_CASE("selection policies") {
+
+    checkSelection<Evolve::FitnessProportionalSelection, 0>(51);
+    checkSelection<Evolve::FitnessProportionalSelection, 2>(50);
+    checkSelection<Evolve::TournamentSelection<3>, 1>(51);
+    checkSelection<Evolve::RankSelection, 2>(50);
+    checkSelection<Evolve::TruncationSelection<30>, 3>(50);
+    checkSelection<Evolve::TournamentSelection<2>, 2, Evolve::CrossAndMutate<2, 2>>(50);
+
+    std::vector<unsigned> scores{1, 5, 3, 9, 2};
+    Evolve::TruncationSelection<40> truncation;
+    truncation.prepare(scores);
+    std::default_random_engine rng;
+    for(int i = 0; i < 100; i++) {
+        auto idx = truncation(rng);
+        REQUIRE((idx == 1 || idx == 3));
+    }
+    /// A tournament of one is uniform selection
+    Evolve::TournamentSelection<1> uniform;
+    uniform.prepare(scores);
+    std::vector<unsigned> counts(scores.size());
+    for(int i = 0; i < 1000; i++) {
+        counts[uniform(rng)]++;
+    }
+    REQUIRE(*std::min_element(std::begin(counts), std::end(counts)) > 100);
+}
+
+TEST_CASE("mating policies") {
+
+    NQueens::Board zeros{{0,0,0,0,0,0,0,0}}, ones{{1,1,1,1,1,1,1,1}};
+    std::default_random_engine rng;
+    for(int i = 0; i < 100; i++) {
+        NQueens::Board child1{zeros}, child2{zeros};
+        Evolve::CrossAndMutate<3, 0>{}(zeros, ones, child1, child2, rng);
+        /// Without mutations, crossing moves genes between the children but never loses one
+        for(size_t idx = 0; idx < NQueens::Board::length; idx++) {
+            REQUIRE(child1[idx] + child2[idx] == 1);
+        }
+    }
+
+    Evolve::Generation<NQueens::Board, TestConfig<Evolve::RankSelection, 0, Evolve::CrossAndMutate<1>>>
+            generation{std::vector<NQueens::Board>(10, zeros)};
+    generation.circleOfLife();
+    REQUIRE(generation.size() == 10);
+}
+
+TEST_CASE("population") {
+
+    std::vector<KnightsTour::Tour> tours;
+    std::generate_n(std::back_inserter(tours), 10, KnightsTour::Tour::random);
+    Evolve::Population<KnightsTour::Tour> population{std::begin(tours), std::end(tours)};
+    REQUIRE(population.size() == 10);
+    REQUIRE(reinterpret_cast<std::uintptr_t>(population.data()) % Evolve::Population<KnightsTour::Tour>::alignment == 0);
+
+    auto fitness = population.resizeFitness();
+    REQUIRE(fitness.size() == 10);
+    REQUIRE(reinterpret_cast<std::uintptr_t>(fitness.data()) % Evolve::Population<KnightsTour::Tour>::alignment == 0);
+
+    Evolve::Population<KnightsTour::Tour> other;
+    other.swap(population);
+    REQUIRE(population.empty());
+    REQUIRE(other.size() == 10);
+    REQUIRE(other.fitness().size() == 10);
+}
+
+template<typename Config>
+void checkSteadyStateAllocations() {
+    std::vector<KnightsTour::Tour> tours;
+    std::generate_n(std::back_inserter(tours), 101, KnightsTour::Tour::random);
+    Evolve::Generation<KnightsTour::Tour, Config> generation{std::move(tours)};
+    for(int i = 0; i < 3; i++) {
+        generation.circleOfLife();
+    }
+
+    for(int i = 0; i < 20 && !generation.hasSolutions(); i++) {
+        auto before = Evolve::allocationCount().load();
+        generation.circleOfLife();
+        REQUIRE(Evolve::allocationCount().load() == before);
+    }
+}
+
+struct CollapseConfig : Evolve::DefaultConfig {
+    static constexpr bool collapseDuplicates = true;
+};
+
+struct RankElitistConfig : Evolve::DefaultConfig {
+    using Selection = Evolve::RankSelection;
+    using Replacement = Evolve::ElitistReplacement<3>;
+};
+
+TEST_CASE("steady state allocations") {
+
+    if constexpr (!Evolve::instrumented) {
+        return;
+    }
+    checkSteadyStateAllocations<Evolve::DefaultConfig>();
+    checkSteadyStateAllocations<RankElitistConfig>();
+    checkSteadyStateAllocations<CollapseConfig>();
+}
+
+/// Counts every copy and move of a specimen
+struct CountingSpecimen {
+    static inline unsigned numCopies{0};
+    static inline unsigned numMates{0};
+
+    unsigned genes_{0};
+
+    CountingSpecimen() = default;
+
+    CountingSpecimen(const CountingSpecimen& other) : genes_{other.genes_} {
+        ++numCopies;
+    }
+
+    CountingSpecimen& operator=(const CountingSpecimen& other) {
+        genes_ = other.genes_;
+        ++numCopies;
+        return *this;
+    }
+
+    static CountingSpecimen random() {
+        return {};
+    }
+};
+
+unsigned score(const CountingSpecimen& specimen) {
+    return specimen.genes_ + 1;
+}
+
+std::tuple<CountingSpecimen, CountingSpecimen> mate(const CountingSpecimen& first, const CountingSpecimen& second) {
+    return {first, second};
+}
+
+void mate(const CountingSpecimen& first, const CountingSpecimen& second, CountingSpecimen& child1, CountingSpecimen& child2) {
+    ++CountingSpecimen::numMates;
+    child1.genes_ = first.genes_ + 1;
+    child2.genes_ = second.genes_ + 1;
+}
+
+bool solved(const CountingSpecimen&) {
+    return false;
+}
+
+TEST_CASE("in place mating") {
+
+    static_assert(Evolve::InPlaceMatingSpecimen<CountingSpecimen>);
+    static_assert(Evolve::InPlaceMatingSpecimen<KnightsTour::Tour>);
+    static_assert(!Evolve::InPlaceMatingSpecimen<NQueens::Board>);
+
+    Evolve::Generation<CountingSpecimen> generation{std::vector<CountingSpecimen>(10)};
+    generation.circleOfLife();
+
+    /// After the first generation has set up the slots, children are only ever
+    /// written by mate()
+    CountingSpecimen::numCopies = CountingSpecimen::numMates = 0;
+    generation.circleOfLife();
+    REQUIRE(CountingSpecimen::numCopies == 0);
+    REQUIRE(CountingSpecimen::numMates == 5);
+    REQUIRE(generation.size() == 10);
+
+    /// Mating in place gives the same children as mating by value
+    std::vector<KnightsTour::Tour> tours;
+    std::generate_n(std::back_inserter(tours), 2, KnightsTour::Tour::random);
+    randomEngine().seed(11);
+    auto [child1, child2] = KnightsTour::mate(tours[0], tours[1]);
+    KnightsTour::Tour inPlace1{tours[0]}, inPlace2{tours[0]};
+    randomEngine().seed(11);
+    KnightsTour::mate(tours[0], tours[1], inPlace1, inPlace2);
+    REQUIRE(inPlace1.tour_ == child1.tour_);
+    REQUIRE(inPlace2.tour_ == child2.tour_);
+    REQUIRE(inPlace1.numValidSteps() == child1.numValidSteps());
+}
+
+struct FusedConfig : Evolve::DefaultConfig {
+    static constexpr bool fuseScoring = true;
+};
+
+template<typename Specimen, typename Config>
+std::vector<std::tuple<unsigned, unsigned, double>> fitnessHistory(unsigned seed) {
+    randomEngine().seed(seed);
+    std::vector<Specimen> specimens;
+    std::generate_n(std::back_inserter(specimens), 31, Specimen::random);
+    Evolve::Generation<Specimen, Config> generation{std::move(specimens)};
+
+    std::vector<std::tuple<unsigned, unsigned, double>> history;
+    Evolve::evolve(generation, 10, [&](const Evolve::GenerationStats& stats) {
+        history.emplace_back(stats.minFitness_, stats.maxFitness_, stats.meanFitness_);
+    });
+    return history;
+}
+
+TEST_CASE("fused scoring") {
+
+    /// Scoring children as they are created gives the same scores as scoring
+    /// them in the next generation
+    REQUIRE(fitnessHistory<NQueens::Board, FusedConfig>(3) == fitnessHistory<NQueens::Board, Evolve::DefaultConfig>(3));
+    REQUIRE(fitnessHistory<KnightsTour::Tour, FusedConfig>(5) == fitnessHistory<KnightsTour::Tour, Evolve::DefaultConfig>(5));
+}
+
+TEST_CASE("collapsed duplicates") {
+
+    /// Scoring each distinct specimen once gives the same scores
+    REQUIRE(fitnessHistory<NQueens::Board, CollapseConfig>(3) == fitnessHistory<NQueens::Board, Evolve::DefaultConfig>(3));
+    REQUIRE(fitnessHistory<KnightsTour::Tour, CollapseConfig>(5) == fitnessHistory<KnightsTour::Tour, Evolve::DefaultConfig>(5));
+
+    NQueens::Board solution{{0,4,7,5,2,6,1,3}}, attacking{{0,0,0,0,0,0,0,0}};
+    std::vector<NQueens::Board> boards(8, attacking);
+    boards.insert(std::begin(boards) + 3, 2, solution);
+    Evolve::Generation<NQueens::Board, CollapseConfig> generation{std::move(boards)};
+    generation.circleOfLife();
+    const auto& stats = generation.stats();
+    REQUIRE(stats.duplicateRatio_);
+    REQUIRE(*stats.duplicateRatio_ == Approx(0.8));
+    REQUIRE(stats.minFitness_ == 0);
+    REQUIRE(stats.maxFitness_ == 28);
+    REQUIRE(stats.meanFitness_ == Approx(2*28/10.0));
+
+    Evolve::Generation<NQueens::Board> uncollapsed{std::vector<NQueens::Board>(4, attacking)};
+    uncollapsed.circleOfLife();
+    REQUIRE_FALSE(uncollapsed.stats().duplicateRatio_);
+
+    /// Tours are told apart by their hashes
+    std::vector<KnightsTour::Tour> tours;
+    std::generate_n(std::back_inserter(tours), 5, KnightsTour::Tour::random);
+    tours.push_back(KnightsTour::extend(tours[0]));
+    tours.push_back(tours[1]);
+    Evolve::detail::DuplicateFinder finder;
+    REQUIRE(finder.find(tours.data(), tours.size(), Evolve::SpecimenFingerprint<KnightsTour::Tour>{}) ==
+            1 + (tours[5].tour_ == tours[0].tour_));
+    REQUIRE(finder.original(6) == 1);
+    REQUIRE(finder.original(4) == 4);
+}
+
+TEST_CASE("declared max fitness") {
+
+    NQueens::Board solution{{0,4,7,5,2,6,1,3}};
+    REQUIRE(NQueens::solved(solution));
+    REQUIRE(NQueens::score(solution) == NQueens::Board::maxFitness);
+
+    /// Solutions are found from their score, and they all really are solutions
+    randomEngine().seed(17);
+    std::vector<NQueens::Board> boards;
+    std::generate_n(std::back_inserter(boards), 50, NQueens::Board::random);
+    Evolve::Generation<NQueens::Board> generation{std::move(boards)};
+    std::vector<NQueens::Board> solutions;
+    generation.setSolutionCallback([&](const NQueens::Board& board) {
+        solutions.push_back(board);
+    });
+    Evolve::evolve(generation, 10000, [](const auto&) {});
+    REQUIRE(generation.hasSolutions());
+    for(const auto& board : solutions) {
+        REQUIRE(NQueens::solved(board));
+    }
+}
+
+/// Every child gets the next serial number and the third child is a solution
+struct SerialSpecimen {
+    static inline unsigned numChildren{0};
+
+    unsigned serial_{0};
+
+    static SerialSpecimen random() {
+        return {};
+    }
+};
+
+unsigned score(const SerialSpecimen&) {
+    return 1;
+}
+
+std::tuple<SerialSpecimen, SerialSpecimen> mate(const SerialSpecimen&, const SerialSpecimen&) {
+    SerialSpecimen child1{++SerialSpecimen::numChildren};
+    SerialSpecimen child2{++SerialSpecimen::numChildren};
+    return {child1, child2};
+}
+
+bool solved(const SerialSpecimen& specimen) {
+    return specimen.serial_ == 3;
+}
+
+struct FirstSolutionConfig : Evolve::DefaultConfig {
+    static constexpr bool stopOnFirstSolution = true;
+};
+
+TEST_CASE("first solution") {
+
+    SerialSpecimen::numChildren = 0;
+    Evolve::Generation<SerialSpecimen, FirstSolutionConfig> generation{std::vector<SerialSpecimen>(100)};
+    REQUIRE(Evolve::evolve(generation, 0, [](const auto&) {}) == 1);
+    REQUIRE(generation.hasSolutions());
+    REQUIRE(generation.cancelled());
+    /// Mating stopped right after the pair that produced the solution
+    REQUIRE(SerialSpecimen::numChildren == 4);
+
+    /// A cancelled generation stays as it is
+    generation.circleOfLife();
+    REQUIRE(SerialSpecimen::numChildren == 4);
+    REQUIRE(generation.stats().generation_ == 1);
+    REQUIRE(generation.population()[0].serial_ == 1);
+
+    /// and evolves again once the cancellation is reset
+    generation.resetCancellation();
+    REQUIRE_FALSE(generation.cancelled());
+    generation.circleOfLife();
+    REQUIRE(SerialSpecimen::numChildren == 104);
+    REQUIRE(generation.stats().generation_ == 2);
+    REQUIRE(generation.population()[0].serial_ == 5);
+    REQUIRE(generation.population()[99].serial_ == 104);
+
+    SerialSpecimen::numChildren = 0;
+    Evolve::Generation<SerialSpecimen> complete{std::vector<SerialSpecimen>(100)};
+    Evolve::evolve(complete, 0, [](const auto&) {});
+    REQUIRE(SerialSpecimen::numChildren == 100);
+
+    /// Cancelling one of the generations sharing a flag stops all of them
+    std::atomic<bool> cancelFlag{false};
+    Evolve::Generation<SerialSpecimen> first{std::vector<SerialSpecimen>(10)}, second{std::vector<SerialSpecimen>(10)};
+    first.shareCancellation(cancelFlag);
+    second.shareCancellation(cancelFlag);
+    first.cancel();
+    REQUIRE(second.cancelled());
+    REQUIRE(Evolve::evolve(second, 0, [](const auto&) {}) == 0);
+    first.resetCancellation();
+    REQUIRE(Evolve::evolve(second, 3, [](const auto&) {}) == 3);
+}
+
+/// The second child of every pair is a solution
+struct SecondChildSolves {
+    bool solves_{false};
+
+    static SecondChildSolves random() {
+        return {};
+    }
+};
+
+unsigned score(const SecondChildSolves&) {
+    return 1;
+}
+
+std::tuple<SecondChildSolves, SecondChildSolves> mate(const SecondChildSolves&, const SecondChildSolves&) {
+    return {SecondChildSolves{false}, SecondChildSolves{true}};
+}
+
+bool solved(const SecondChildSolves& specimen) {
+    return specimen.solves_;
+}
+
+TEST_CASE("solution in the spare child") {
+
+    /// With 3 specimens the second child of the second pair has no slot, it is
+    /// still a solution
+    Evolve::Generation<SecondChildSolves> generation{std::vector<SecondChildSolves>(3)};
+    unsigned numSolutions{0};
+    generation.setSolutionCallback([&](const SecondChildSolves&) { ++numSolutions; });
+    generation.circleOfLife();
+    REQUIRE(numSolutions == 2);
+    REQUIRE(generation.size() == 3);
+}
+
+template<typename Specimen, typename Config = Evolve::DefaultConfig>
+struct Run {
+    Evolve::Generation<Specimen, Config> generation_;
+    std::vector<std::tuple<unsigned, unsigned, unsigned, double>> history_;
+
+    Run() : generation_{randomSpecimens(30)}
+    {}
+
+    static std::vector<Specimen> randomSpecimens(size_t count) {
+        std::vector<Specimen> specimens;
+        std::generate_n(std::back_inserter(specimens), count, Specimen::random);
+        return specimens;
+    }
+
+    void evolve(unsigned numGenerations) {
+        for(unsigned i = 0; i < numGenerations; i++) {
+            generation_.circleOfLife();
+            const auto& stats = generation_.stats();
+            history_.emplace_back(stats.generation_, stats.minFitness_, stats.maxFitness_, stats.meanFitness_);
+        }
+    }
+};
+
+template<typename Specimen, typename Config = Evolve::DefaultConfig>
+void checkResume() {
+    randomEngine().seed(23);
+    Run<Specimen, Config> original;
+    original.evolve(3);
+    std::vector<char> checkpoint;
+    original.generation_.checkpoint(checkpoint);
+    original.evolve(5);
+
+    /// A run resumed from the checkpoint carries on exactly like the original
+    Run<Specimen, Config> resumed;
+    REQUIRE(resumed.generation_.restore(checkpoint));
+    resumed.evolve(5);
+    REQUIRE(std::equal(std::begin(resumed.history_), std::end(resumed.history_), std::begin(original.history_) + 3));
+}
+
+TEST_CASE("checkpoint") {
+
+    static_assert(Evolve::TriviallyCopyableSpecimen<NQueens::Board>);
+
+    checkResume<KnightsTour::Tour>();
+    checkResume<NQueens::Board>();
+    checkResume<NQueens::Board, FusedConfig>();
+
+    Run<NQueens::Board> run;
+    std::vector<char> checkpoint;
+    run.generation_.checkpoint(checkpoint);
+    REQUIRE_FALSE(run.generation_.restore(std::span<const char>{checkpoint}.first(checkpoint.size() - 1)));
+    Run<KnightsTour::Tour> other;
+    REQUIRE_FALSE(other.generation_.restore(checkpoint));
+
+    /// Corrupt sizes are rejected before anything is allocated for them
+    auto corrupted = [&](auto corrupt) {
+        auto bytes = checkpoint;
+        Evolve::detail::CheckpointHeader header;
+        std::memcpy(&header, bytes.data(), sizeof(header));
+        corrupt(header);
+        std::memcpy(bytes.data(), &header, sizeof(header));
+        return bytes;
+    };
+    REQUIRE_FALSE(run.generation_.restore(corrupted([](auto& header) { header.populationSize_ = 1ull << 60; })));
+    REQUIRE_FALSE(run.generation_.restore(corrupted([](auto& header) { header.populationSize_ += 1; })));
+    REQUIRE_FALSE(run.generation_.restore(corrupted([](auto& header) { header.scored_ = 1; })));
+    REQUIRE_FALSE(run.generation_.restore(corrupted([](auto& header) { header.randomStateSize_ = ~0u; })));
+    REQUIRE(run.generation_.restore(checkpoint));
+
+    /// Through a file written in the background
+    std::string path{"evolve_test.ckpt"};
+    std::remove(path.c_str());
+    run.evolve(2);
+    {
+        Evolve::Checkpointer checkpointer{run.generation_, path, 2};
+        checkpointer(run.generation_.stats());
+        checkpointer.wait();
+        REQUIRE(checkpointer.numFailed() == 0);
+    }
+    {
+        Evolve::Checkpointer checkpointer{run.generation_, "no_such_directory/" + path, 2};
+        checkpointer.save();
+        checkpointer.wait();
+        REQUIRE(checkpointer.numFailed() == 1);
+    }
+    Run<NQueens::Board> resumed;
+    REQUIRE(Evolve::restore(resumed.generation_, path));
+    REQUIRE(resumed.generation_.stats().generation_ == 2);
+    REQUIRE(std::equal(std::begin(resumed.generation_.population()), std::end(resumed.generation_.population()),
+                       std::begin(run.generation_.population()), std::end(run.generation_.population()),
+                       [](const auto& lhs, const auto& rhs) { return lhs.board_ == rhs.board_; }));
+    std::remove(path.c_str());
+    REQUIRE_FALSE(Evolve::restore(resumed.generation_, path));
+}
+
+TEST_CASE("mapped cache") {
+
+    std::string path{"evolve_test.cache"};
+    std::remove(path.c_str());
+
+    unsigned numCalls{0};
+    auto square = [&numCalls](const int& i) {
+        ++numCalls;
+        return static_cast<unsigned>(i*i);
+    };
+    using CacheT = Memoizer::MappedCache<decltype(square), int>;
+    {
+        Memoizer::Memoizer<CacheT, decltype(square)> memoizer{square, CacheT{path, 1000}};
+        REQUIRE(memoizer.cache_.mapped());
+        REQUIRE(memoizer.cache_.capacity() == 1024);
+        for(int i = 0; i < 100; i++) {
+            REQUIRE(memoizer(i) == static_cast<unsigned>(i*i));
+        }
+        REQUIRE(numCalls == 100);
+    }
+
+    /// Results persist in the file, and an existing table keeps its capacity
+    {
+        Memoizer::Memoizer<CacheT, decltype(square)> memoizer{square, CacheT{path, 10}};
+        REQUIRE(memoizer.cache_.capacity() == 1024);
+        for(int i = 0; i < 100; i++) {
+            REQUIRE(memoizer(i) == static_cast<unsigned>(i*i));
+        }
+        REQUIRE(numCalls == 100);
+        REQUIRE(memoizer.stats_.hits_ == 100);
+    }
+
+    /// Concurrent users of the file see each other's results
+    {
+        CacheT first{path, 0}, second{path, 0};
+        std::thread writer{[&]() {
+            for(int i = 100; i < 500; i++) {
+                first.store(i*i, i);
+            }
+        }};
+        for(int i = 100; i < 500; i++) {
+            auto cached = second.lookup(i);
+            REQUIRE((!cached || *cached == static_cast<unsigned>(i*i)));
+        }
+        writer.join();
+        for(int i = 100; i < 500; i++) {
+            REQUIRE(second.lookup(i) == static_cast<unsigned>(i*i));
+        }
+    }
+    std::remove(path.c_str());
+
+    /// A full table stops caching rather than returning wrong results
+    {
+        CacheT tiny{path, 4};
+        for(int i = 0; i < 100; i++) {
+            tiny.store(i*i, i);
+        }
+        for(int i = 0; i < 100; i++) {
+            auto cached = tiny.lookup(i);
+            REQUIRE((!cached || *cached == static_cast<unsigned>(i*i)));
+        }
+    }
+    std::remove(path.c_str());
+
+    /// A file that is not a table is left alone
+    {
+        std::ofstream{path} << "not a cache";
+    }
+    CacheT invalid{path, 16};
+    REQUIRE_FALSE(invalid.mapped());
+    REQUIRE_FALSE(invalid.lookup(1));
+    std::remove(path.c_str());
+
+    KnightsTour::Tour tour{KnightsTour::Tour::random()};
+    auto extended = KnightsTour::extend(tour);
+    extended.tour_ = tour.tour_;
+    extended.rehash();
+    REQUIRE(KnightsTour::TourFingerprint{}(tour) == KnightsTour::TourFingerprint{}(extended));
+}
+
+TEST_CASE("knightstour zobrist hash") {
+    /// The hash a tour would have if it was computed from scratch
+    auto rehashed = [](KnightsTour::Tour tour) {
+        tour.rehash();
+        return tour.hash_;
+    };
+
+    std::vector<KnightsTour::Tour> tours;
+    std::generate_n(std::back_inserter(tours), 20, KnightsTour::Tour::random);
+    for(size_t i = 0; i + 1 < tours.size(); i++) {
+        const auto& first = tours[i];
+        const auto& second = tours[i+1];
+        REQUIRE(first.hash_ != second.hash_);
+        for(size_t crossPoint : {size_t{0}, size_t{1}, size_t{31}, size_t{32}, size_t{62}, size_t{63}}) {
+            auto [child1, child2] = KnightsTour::cross(first, second, crossPoint);
+            REQUIRE(child1.hash_ == rehashed(child1));
+            REQUIRE(child2.hash_ == rehashed(child2));
+        }
+        auto mutated = KnightsTour::mutate(first);
+        REQUIRE(mutated.hash_ == rehashed(mutated));
+        auto extended = KnightsTour::extend(mutated);
+        REQUIRE(extended.hash_ == rehashed(extended));
+        auto [child1, child2] = KnightsTour::mate(first, second);
+        REQUIRE(child1.hash_ == rehashed(child1));
+        REQUIRE(child2.hash_ == rehashed(child2));
+        KnightsTour::Tour inPlace1{first}, inPlace2{first};
+        KnightsTour::mate(first, second, inPlace1, inPlace2);
+        REQUIRE(inPlace1.hash_ == rehashed(inPlace1));
+        REQUIRE(inPlace2.hash_ == rehashed(inPlace2));
+    }
+
+    /// Repair rewrites the tail of the tour
+    for(const auto& tour : tours) {
+        auto extended = KnightsTour::extend(tour, {5, 1000});
+        REQUIRE(extended.hash_ == rehashed(extended));
+    }
+
+    /// Equal tours hash the same however they were made
+    KnightsTour::Tour copy{tours[0]};
+    for(size_t idx = 0; idx < KnightsTour::Tour::length; idx++) {
+        copy.setMov(idx, tours[1].tour_[idx]);
+    }
+    REQUIRE(copy.hash_ == tours[1].hash_);
+    REQUIRE(Evolve::SpecimenFingerprint<KnightsTour::Tour>{}(copy) == tours[1].hash_);
+
+    /// The score cache is keyed by the hash
+    auto misses = KnightsTour::scoreMemoizer().stats_.misses_;
+    REQUIRE(KnightsTour::score(copy) == KnightsTour::score(tours[1]));
+    REQUIRE(KnightsTour::scoreMemoizer().stats_.misses_ <= misses + 1);
+}
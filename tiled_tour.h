@@ -0,0 +1,429 @@
+#pragma once
+
+#include <vector>
+#include <array>
+#include <optional>
+#include <random>
+#include <thread>
+#include <atomic>
+#include <algorithm>
+#include <ostream>
+#include <iomanip>
+#include <cstdint>
+#include <cstdlib>
+#include <string>
+
+/**
+ * \ingroup Evolve
+ *
+ * This file solves the Knights tour problem for boards that are far too large for
+ * the evolutionary approach of knights_tour.h (whose cost grows with the board area
+ * on every replay).
+ *
+ * We use a divide and conquer approach. The board is tiled into sub-boards of 5 to 10
+ * rows and columns and a closed tour is found on each sub-board using Warnsdorff's
+ * heuristic. The sub-boards are independent so they are solved in parallel.
+ *
+ * The closed tours are then stitched together one sub-board at a time. Given an edge
+ * a-b of the tour built so far and an edge c-d of the tour of a neighbouring sub-board,
+ * where a-c and b-d are knight moves, replacing a-b and c-d by a-c and b-d joins the
+ * two cycles into a single cycle.
+ *
+ * A board with an odd number of rows and columns has no closed tour. In that case the
+ * bottom right sub-board is covered by an open tour instead, which is appended to the
+ * end of the stitched cycle, and the result is an open tour.
+ *
+ * The sub-boards are not solved with Evolve::Generation because KnightsTour::Tour
+ * is fixed to an 8x8 board and an open tour from e5, whereas stitching needs closed
+ * tours on sub-boards of varying sizes.
+ */
+
+namespace TiledTour {
+
+/// A knight's tour of a numRows_ x numCols_ board. squares_ holds the visited
+/// squares (as row major indices) in the order they are visited
+struct Tour {
+    int numRows_;
+    int numCols_;
+    std::vector<int> squares_;
+};
+
+/// A rectangular board with the knight moves from each square precomputed.
+/// Squares are row major indices
+class Grid {
+    int numRows_;
+    int numCols_;
+    std::vector<std::array<int,8>> targets_;
+    std::vector<std::uint8_t> numTargets_;
+
+public:
+    Grid(int numRows, int numCols) :
+        numRows_{numRows},
+        numCols_{numCols},
+        targets_(numRows*numCols),
+        numTargets_(numRows*numCols, 0)
+    {
+        static constexpr int deltas[8][2] = {{1,2},{1,-2},{2,1},{2,-1},
+                                             {-1,2},{-1,-2},{-2,1},{-2,-1}};
+        for(int r = 0; r < numRows_; r++) {
+            for(int c = 0; c < numCols_; c++) {
+                int sq = r*numCols_ + c;
+                for(const auto& delta : deltas) {
+                    int nr = r + delta[0], nc = c + delta[1];
+                    if(nr >= 0 && nr < numRows_ && nc >= 0 && nc < numCols_) {
+                        targets_[sq][numTargets_[sq]++] = nr*numCols_ + nc;
+                    }
+                }
+            }
+        }
+    }
+
+    int numRows() const { return numRows_; }
+    int numCols() const { return numCols_; }
+    int size() const { return numRows_*numCols_; }
+
+    template<typename F>
+    void forEachTarget(int sq, F&& f) const {
+        for(unsigned i = 0; i < numTargets_[sq]; i++) {
+            f(targets_[sq][i]);
+        }
+    }
+
+    bool isKnightMove(int from, int to) const {
+        int dr = std::abs(from/numCols_ - to/numCols_);
+        int dc = std::abs(from%numCols_ - to%numCols_);
+        return (dr == 1 && dc == 2) || (dr == 2 && dc == 1);
+    }
+};
+
+/// Walk the board from start using Warnsdorff's heuristic, i.e. always move to the
+/// square with the fewest onward moves, breaking ties randomly. Returns the squares
+/// visited, which will be fewer than the whole board if we run into a dead end
+template<typename Rng>
+std::vector<int> warnsdorff(const Grid& grid, int start, Rng& rng) {
+    std::vector<std::uint8_t> visited(grid.size(), 0);
+    std::vector<int> path;
+    path.reserve(grid.size());
+
+    int curr = start;
+    visited[curr] = 1;
+    path.push_back(curr);
+    while(static_cast<int>(path.size()) < grid.size()) {
+        int best{-1};
+        unsigned bestDegree{9}, numTies{0};
+        grid.forEachTarget(curr, [&](int next) {
+            if(visited[next]) {
+                return;
+            }
+            unsigned degree{0};
+            grid.forEachTarget(next, [&](int onward) { degree += !visited[onward]; });
+            if(degree < bestDegree) {
+                best = next;
+                bestDegree = degree;
+                numTies = 1;
+            } else if(degree == bestDegree &&
+                      std::uniform_int_distribution<unsigned>{0, numTies++}(rng) == 0) {
+                best = next;
+            }
+        });
+        if(best < 0) {
+            break;
+        }
+        curr = best;
+        visited[curr] = 1;
+        path.push_back(curr);
+    }
+    return path;
+}
+
+/// Find a closed tour on grid, retrying Warnsdorff's heuristic from random squares
+template<typename Rng>
+std::optional<std::vector<int>> closedTour(const Grid& grid, Rng& rng, unsigned maxAttempts = 10000) {
+    std::uniform_int_distribution<int> distribution(0, grid.size()-1);
+    for(unsigned attempt = 0; attempt < maxAttempts; attempt++) {
+        auto path = warnsdorff(grid, distribution(rng), rng);
+        if(static_cast<int>(path.size()) == grid.size() && grid.isKnightMove(path.back(), path.front())) {
+            return path;
+        }
+    }
+    return std::nullopt;
+}
+
+/// Find an open tour on grid that starts from start
+template<typename Rng>
+std::optional<std::vector<int>> openTour(const Grid& grid, int start, Rng& rng, unsigned maxAttempts = 10000) {
+    for(unsigned attempt = 0; attempt < maxAttempts; attempt++) {
+        auto path = warnsdorff(grid, start, rng);
+        if(static_cast<int>(path.size()) == grid.size()) {
+            return path;
+        }
+    }
+    return std::nullopt;
+}
+
+/// Split a board dimension into sub-board dimensions between 5 and 10. At most one
+/// piece is odd and if so, it is the last one
+inline
+std::vector<int> splitDimension(int length) {
+    if(length <= 10) {
+        return {length};
+    }
+    std::vector<int> pieces(length/8, 8);
+    switch(length % 8) {
+    case 0: break;
+    case 1: pieces.back() = 9; break;
+    case 2: pieces.back() = 10; break;
+    case 3: pieces.back() = 6; pieces.push_back(5); break;
+    case 4: pieces.back() = 6; pieces.push_back(6); break;
+    default: pieces.push_back(length % 8); break;
+    }
+    return pieces;
+}
+
+/// Check that tour visits every square of the board exactly once using knight moves
+inline
+bool isValid(const Tour& tour) {
+    Grid grid{tour.numRows_, tour.numCols_};
+    if(static_cast<int>(tour.squares_.size()) != grid.size()) {
+        return false;
+    }
+    std::vector<std::uint8_t> visited(grid.size(), 0);
+    for(size_t i = 0; i < tour.squares_.size(); i++) {
+        int sq = tour.squares_[i];
+        if(sq < 0 || sq >= grid.size() || visited[sq]) {
+            return false;
+        }
+        if(i > 0 && !grid.isKnightMove(tour.squares_[i-1], sq)) {
+            return false;
+        }
+        visited[sq] = 1;
+    }
+    return true;
+}
+
+namespace detail {
+
+/// A sub-board of the full board
+struct Tile {
+    int row0_;
+    int col0_;
+    int numRows_;
+    int numCols_;
+
+    bool open() const {
+        return (numRows_ % 2) && (numCols_ % 2);
+    }
+
+    int toBoard(int localSq, int boardCols) const {
+        return (row0_ + localSq/numCols_)*boardCols + col0_ + localSq%numCols_;
+    }
+};
+
+/// Solve a tile, returning its tour in board coordinates. Open tiles start from
+/// their top left corner, which is always on the majority colour
+template<typename Rng>
+std::optional<std::vector<int>> solveTile(const Tile& tile, int boardCols, Rng& rng) {
+    Grid grid{tile.numRows_, tile.numCols_};
+    auto path = tile.open() ? openTour(grid, 0, rng) : closedTour(grid, rng);
+    if(path) {
+        for(auto& sq : *path) {
+            sq = tile.toBoard(sq, boardCols);
+        }
+    }
+    return path;
+}
+
+/// The stitched cycle, stored as the two tour neighbours of each square
+class Cycle {
+    std::vector<std::array<int,2>> links_;
+
+    void relink(int sq, int from, int to) {
+        auto& links = links_[sq];
+        (links[0] == from ? links[0] : links[1]) = to;
+    }
+
+public:
+    explicit Cycle(int numSquares) : links_(numSquares, {-1,-1})
+    {}
+
+    void add(const std::vector<int>& closedPath) {
+        for(size_t i = 0; i < closedPath.size(); i++) {
+            int sq = closedPath[i];
+            links_[sq][0] = closedPath[(i + closedPath.size() - 1) % closedPath.size()];
+            links_[sq][1] = closedPath[(i + 1) % closedPath.size()];
+        }
+    }
+
+    const std::array<int,2>& links(int sq) const {
+        return links_[sq];
+    }
+
+    /// Replace edges a-b and c-d by a-c and b-d
+    void swapEdges(int a, int b, int c, int d) {
+        relink(a, b, c);
+        relink(b, a, d);
+        relink(c, d, a);
+        relink(d, c, b);
+    }
+
+    /// Walk the cycle starting from start, first moving away from prev. prev is the
+    /// last square visited
+    std::vector<int> walk(int start, int prev) const {
+        std::vector<int> path;
+        path.reserve(links_.size());
+        int curr = start;
+        do {
+            path.push_back(curr);
+            int next = links_[curr][0] == prev ? links_[curr][1] : links_[curr][0];
+            prev = curr;
+            curr = next;
+        } while(curr != start);
+        return path;
+    }
+};
+
+/// Join the cycle of a tile (whose squares are given by path) into the cycle
+/// built so far. inCycle marks the squares already stitched
+inline
+bool stitch(Cycle& cycle, const Grid& board, const std::vector<int>& path,
+            const std::vector<std::uint8_t>& inCycle) {
+    for(int a : path) {
+        for(int b : cycle.links(a)) {
+            bool done{false};
+            board.forEachTarget(a, [&](int c) {
+                if(done || !inCycle[c]) {
+                    return;
+                }
+                for(int d : cycle.links(c)) {
+                    if(board.isKnightMove(b, d)) {
+                        cycle.swapEdges(a, b, c, d);
+                        done = true;
+                        return;
+                    }
+                }
+            });
+            if(done) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+}
+
+/// Solve the Knights tour problem on a numRows x numCols board. Both dimensions
+/// must be atleast 5. Sub-boards are solved on numThreads threads. The result is
+/// a closed tour unless both dimensions are odd.
+inline
+std::optional<Tour> solve(int numRows, int numCols, unsigned seed,
+                          unsigned numThreads = std::max(1u, std::thread::hardware_concurrency())) {
+    if(numRows < 5 || numCols < 5) {
+        return std::nullopt;
+    }
+
+    std::vector<detail::Tile> tiles;
+    int row0{0};
+    for(int tileRows : splitDimension(numRows)) {
+        int col0{0};
+        for(int tileCols : splitDimension(numCols)) {
+            tiles.push_back({row0, col0, tileRows, tileCols});
+            col0 += tileCols;
+        }
+        row0 += tileRows;
+    }
+
+    /// Solve all the tiles in parallel. Each tile has its own random engine so the
+    /// result only depends on seed
+    std::vector<std::optional<std::vector<int>>> paths(tiles.size());
+    std::atomic<size_t> nextTile{0};
+    auto worker = [&]() {
+        for(size_t idx = nextTile++; idx < tiles.size(); idx = nextTile++) {
+            std::default_random_engine rng{seed + static_cast<unsigned>(idx)};
+            paths[idx] = detail::solveTile(tiles[idx], numCols, rng);
+        }
+    };
+    std::vector<std::thread> workers;
+    for(unsigned i = 1; i < std::min<size_t>(numThreads, tiles.size()); i++) {
+        workers.emplace_back(worker);
+    }
+    worker();
+    for(auto& thread : workers) {
+        thread.join();
+    }
+    if(std::any_of(std::begin(paths), std::end(paths), [](const auto& path) { return !path; })) {
+        return std::nullopt;
+    }
+
+    Tour tour{numRows, numCols, {}};
+    if(tiles.size() == 1) {
+        tour.squares_ = std::move(*paths.front());
+        return tour;
+    }
+
+    /// Stitch the closed tours in row major order. Every tile has an already
+    /// stitched neighbour above or to its left. If no pair of edges can be swapped,
+    /// we retry with another tour of the tile
+    Grid board{numRows, numCols};
+    detail::Cycle cycle{board.size()};
+    std::vector<std::uint8_t> inCycle(board.size(), 0);
+    std::default_random_engine rng{seed + static_cast<unsigned>(tiles.size())};
+    const bool open = tiles.back().open();
+    const size_t numClosed = open ? tiles.size() - 1 : tiles.size();
+    for(size_t idx = 0; idx < numClosed; idx++) {
+        auto& path = *paths[idx];
+        cycle.add(path);
+        unsigned attempt{0};
+        while(idx > 0 && !detail::stitch(cycle, board, path, inCycle)) {
+            auto retry = ++attempt < 100 ? detail::solveTile(tiles[idx], numCols, rng) : std::nullopt;
+            if(!retry) {
+                return std::nullopt;
+            }
+            path = std::move(*retry);
+            cycle.add(path);
+        }
+        for(int sq : path) {
+            inCycle[sq] = 1;
+        }
+    }
+
+    if(!open) {
+        tour.squares_ = cycle.walk(0, cycle.links(0)[0]);
+        return tour;
+    }
+
+    /// The open tile starts from its top left corner u. Any knight move a from u into
+    /// the cycle lets us break the cycle at a and continue into the open tile
+    const auto& openPath = *paths.back();
+    int u = openPath.front();
+    std::optional<int> a;
+    board.forEachTarget(u, [&](int sq) {
+        if(!a && inCycle[sq]) {
+            a = sq;
+        }
+    });
+    if(!a) {
+        return std::nullopt;
+    }
+    tour.squares_ = cycle.walk(cycle.links(*a)[0], *a);
+    tour.squares_.insert(std::end(tour.squares_), std::begin(openPath), std::end(openPath));
+    return tour;
+}
+
+inline
+std::ostream& operator<<(std::ostream& os, const Tour& tour) {
+    std::vector<int> order(tour.numRows_*tour.numCols_, 0);
+    for(size_t i = 0; i < tour.squares_.size(); i++) {
+        order[tour.squares_[i]] = i + 1;
+    }
+    const int width = std::to_string(order.size()).size() + 1;
+    for(int r = tour.numRows_ - 1; r >= 0; r--) {
+        for(int c = 0; c < tour.numCols_; c++) {
+            os << std::setw(width) << order[r*tour.numCols_ + c];
+        }
+        os << '\n';
+    }
+    return os;
+}
+
+}